@@ -0,0 +1,208 @@
+#pragma once
+
+#include <vector>
+#include <numeric>
+#include <cstdint>
+#include <atomic>
+#include <utility>
+
+//Union-find over flat arrays: parent index plus a one byte rank per element
+//(union by rank keeps ranks below 32). findSet is iterative with path halving,
+//so neither finds nor unions allocate.
+class DisjointSet {
+public:
+    DisjointSet(int V) : parent(V), rank(V, 0) {
+        std::iota(std::begin(parent), std::end(parent), 0);
+    }
+
+    void makeSet(int u) {
+        parent[u] = u;
+        rank[u] = 0;
+    }
+
+    int findSet(int u) {
+        while (parent[u] != u) {
+            parent[u] = parent[parent[u]];
+            u = parent[u];
+        }
+        return u;
+    }
+
+    //findSet without path halving. It writes nothing, so any number of
+    //threads may call it at once while no union runs.
+    int root(int u) const {
+        while (parent[u] != u) {
+            u = parent[u];
+        }
+        return u;
+    }
+
+    //Returns false when u and v already were in the same set.
+    bool unionSets(int u, int v) {
+        u = findSet(u);
+        v = findSet(v);
+
+        if (u == v)
+            return false;
+
+        if (rank[u] > rank[v]) {
+            parent[v] = u;
+        }
+        else if (rank[u] < rank[v]) {
+            parent[u] = v;
+        }
+        else {
+            parent[u] = v;
+            rank[v]++;
+        }
+        return true;
+    }
+
+    int size() const {
+        return static_cast<int>(parent.size());
+    }
+
+private:
+    std::vector<int> parent;
+    std::vector<std::uint8_t> rank;
+};
+
+//Lock-free union-find for many threads calling unionSets/findSet at once.
+//Roots are linked with a CAS on the root's own parent slot, always pointing
+//the larger id at the smaller one so concurrent links cannot form a cycle.
+//findSet compresses with path splitting; a failed splitting CAS only means
+//another thread already moved the pointer closer to the root, so finds
+//never retry and are wait-free.
+class ConcurrentDisjointSet {
+public:
+    ConcurrentDisjointSet(int V) : parent(V) {
+        for (int u = 0; u <= V-1; ++u) {
+            parent[u].store(u, std::memory_order_relaxed);
+        }
+    }
+
+    int findSet(int u) {
+        while (true) {
+            int p = parent[u].load(std::memory_order_acquire);
+            int gp = parent[p].load(std::memory_order_acquire);
+            if (p == gp)
+                return p;
+
+            parent[u].compare_exchange_weak(p, gp, std::memory_order_release, std::memory_order_relaxed);
+            u = p;
+        }
+    }
+
+    //Returns false when u and v already were in the same set.
+    bool unionSets(int u, int v) {
+        while (true) {
+            u = findSet(u);
+            v = findSet(v);
+            if (u == v)
+                return false;
+
+            if (u < v)
+                std::swap(u, v);
+
+            int expected = u;
+            if (parent[u].compare_exchange_strong(expected, v, std::memory_order_acq_rel))
+                return true;
+        }
+    }
+
+    //Safe against concurrent unions: u and v are only reported apart once u
+    //was seen to still be a root after both finds.
+    bool sameSet(int u, int v) {
+        while (true) {
+            u = findSet(u);
+            v = findSet(v);
+            if (u == v)
+                return true;
+
+            if (parent[u].load(std::memory_order_acquire) == u)
+                return false;
+        }
+    }
+
+    int size() const {
+        return static_cast<int>(parent.size());
+    }
+
+private:
+    std::vector<std::atomic<int>> parent;
+};
+
+//Union-find that can undo unions: union by rank without path compression
+//keeps every find O(log V), and each successful union pushes the root it
+//hung below another onto a history stack. snapshot() marks the current
+//history depth and rollback() pops unions back to a mark.
+class RollbackDisjointSet {
+public:
+    RollbackDisjointSet(int V) : parent(V), rank(V, 0), components(V) {
+        std::iota(std::begin(parent), std::end(parent), 0);
+    }
+
+    int findSet(int u) const {
+        while (parent[u] != u) {
+            u = parent[u];
+        }
+        return u;
+    }
+
+    //Returns false when u and v already were in the same set.
+    bool unionSets(int u, int v) {
+        u = findSet(u);
+        v = findSet(v);
+
+        if (u == v)
+            return false;
+
+        if (rank[u] > rank[v])
+            std::swap(u, v);
+
+        bool rankUp = rank[u] == rank[v];
+        parent[u] = v;
+        if (rankUp)
+            rank[v]++;
+
+        history.emplace_back(Change{u, rankUp});
+        --components;
+        return true;
+    }
+
+    std::size_t snapshot() const {
+        return history.size();
+    }
+
+    void rollback(std::size_t mark) {
+        while (history.size() > mark) {
+            Change change = history.back();
+            history.pop_back();
+
+            int root = parent[change.child];
+            if (change.rankUp)
+                rank[root]--;
+            parent[change.child] = change.child;
+            ++components;
+        }
+    }
+
+    int componentCount() const {
+        return components;
+    }
+
+    int size() const {
+        return static_cast<int>(parent.size());
+    }
+
+private:
+    struct Change {
+        int child = 0;
+        bool rankUp = false;
+    };
+
+    std::vector<int> parent;
+    std::vector<std::uint8_t> rank;
+    std::vector<Change> history;
+    int components = 0;
+};
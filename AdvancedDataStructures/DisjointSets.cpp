@@ -1,65 +1,44 @@
 #include <iostream>
 #include <vector>
 #include <unordered_map>
-#include <memory>
-
-struct Set {
-    using Ptr = std::shared_ptr<Set>;
-    int id = 0;
-    int rank = 0;
-    Ptr parentPtr = nullptr;
-};
-
-
-class DisjointSet{
-public:
-    DisjointSet(int V) {
-        sets.resize(V, Set::Ptr());
-    }
-
-    void makeSet(int u) {
-        Set::Ptr ptr(new Set());
-        ptr->id = u;
-        ptr->parentPtr = ptr;
-        sets[u] = ptr;
-    }
-
-
-    Set::Ptr findSet(int u) {
-        return findSet(sets[u]);
-    }
-
-    Set::Ptr findSet(Set::Ptr ptr) {
-        if (ptr->id != ptr->parentPtr->id) {
-            ptr->parentPtr = findSet(ptr->parentPtr);
+#include <string>
+#include <thread>
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <functional>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "DisjointSet.h"
+
+//Runs f(i) for i in [begin, end), statically split into one chunk per thread.
+template <typename F>
+void parallelFor(std::size_t begin, std::size_t end, int threads, F f) {
+    std::size_t T = std::max(1, threads);
+    std::size_t chunk = (end - begin + T - 1) / T;
+    if (chunk == 0)
+        return;
+
+    auto run = [&](std::size_t from, std::size_t to) {
+        for (std::size_t i = from; i < to; ++i) {
+            f(i);
         }
+    };
 
-        return ptr->parentPtr;
+    std::vector<std::thread> workers;
+    for (std::size_t from = begin + chunk; from < end; from += chunk) {
+        workers.emplace_back(run, from, std::min(end, from + chunk));
     }
+    run(begin, std::min(end, begin + chunk));
 
-    void unionSets(int u, int v) {
-        Set::Ptr ptrU = findSet(u);
-        Set::Ptr ptrV = findSet(v);
-        
-        if (ptrU->id == ptrV->id) 
-            return;
-
-        if (ptrU->rank > ptrV->rank) {
-            ptrV->parentPtr = ptrU;
-        }
-        else if (ptrU->rank < ptrV->rank) {
-            ptrU->parentPtr = ptrV;
-        }
-        else {
-            ptrU->parentPtr = ptrV;
-            ptrV->rank++;
-        }
+    for (auto &worker: workers) {
+        worker.join();
     }
-
-private:
-    std::vector<Set::Ptr> sets;
-};
-
+}
 
 //Graph
 struct Node {
@@ -108,6 +87,10 @@ public:
         return adjList[u.id];
     }
 
+    std::vector<Edge>& getEdges(int u) {
+        return adjList[u];
+    }
+
     std::vector<Edge>& getEdges() {
         return edges;
     }
@@ -140,27 +123,329 @@ private:
 
 class ConnectedComponents {
 public:
-    ConnectedComponents(Graph& graph) : graph(graph), disjointSet(graph.getV()) {
-        for (auto &node: graph.getNodes()) {
-            disjointSet.makeSet(node.id);
+    //Shards the edge list across threads, every thread unions its own slice
+    //into the shared lock-free set.
+    ConnectedComponents(Graph& graph, int threads = std::thread::hardware_concurrency()) :
+        graph(graph), threads(threads), disjointSet(graph.getV()) {
+
+        auto &edges = graph.getEdges();
+        parallelFor(0, edges.size(), threads, [&](std::size_t i) {
+            disjointSet.unionSets(edges[i].u, edges[i].v);
+        });
+    }
+
+    bool sameComponent(const std::string &a, const std::string &b) {
+        Node nodeA = graph.getNode(a);
+        Node nodeB = graph.getNode(b);
+
+        return disjointSet.sameSet(nodeA.id, nodeB.id);
+    }
+
+    //Batch query on node ids: result[i] is 1 when a[i] and b[i] share a
+    //component. Runs as two gathers and a compare over the dense labels,
+    //eight queries per step with AVX2.
+    std::vector<std::uint8_t> sameComponent(const std::vector<int> &a, const std::vector<int> &b) {
+        const std::vector<int> &label = getLabels();
+        std::size_t n = std::min(a.size(), b.size());
+        std::vector<std::uint8_t> result(n);
+
+        parallelFor(0, (n + BLOCK - 1) / BLOCK, threads, [&](std::size_t block) {
+            std::size_t i = block * BLOCK;
+            std::size_t end = std::min(n, i + BLOCK);
+#if defined(__AVX2__)
+            for (; i + 8 <= end; i += 8) {
+                __m256i ia = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&a[i]));
+                __m256i ib = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&b[i]));
+                __m256i la = _mm256_i32gather_epi32(label.data(), ia, 4);
+                __m256i lb = _mm256_i32gather_epi32(label.data(), ib, 4);
+                int mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(la, lb)));
+                for (int k = 0; k <= 7; ++k) {
+                    result[i+k] = (mask >> k) & 1;
+                }
+            }
+#endif
+            for (; i < end; ++i) {
+                result[i] = label[a[i]] == label[b[i]];
+            }
+        });
+        return result;
+    }
+
+    //Dense component id of every node, in [0, componentCount()). Built on
+    //first use by pointing every node straight at its root and numbering the
+    //roots, the set is not touched afterwards.
+    const std::vector<int>& getLabels() {
+        if (labels.empty() && graph.getV() > 0) {
+            compact();
+        }
+        return labels;
+    }
+
+    int componentCount() {
+        getLabels();
+        return count;
+    }
+
+private:
+    static const std::size_t BLOCK = 1 << 14;
+
+    void compact() {
+        int V = graph.getV();
+        std::vector<int> root(V);
+        parallelFor(0, V, threads, [&](std::size_t u) {
+            root[u] = disjointSet.findSet(static_cast<int>(u));
+        });
+
+        std::vector<int> dense(V, -1);
+        count = 0;
+        for (int u = 0; u <= V-1; ++u) {
+            if (root[u] == u)
+                dense[u] = count++;
         }
 
-        for (auto &e: graph.getEdges()) {
-            disjointSet.unionSets(e.u, e.v);
+        labels.resize(V);
+        parallelFor(0, V, threads, [&](std::size_t u) { labels[u] = dense[root[u]]; });
+    }
+
+    Graph &graph;
+    int threads = 1;
+    ConcurrentDisjointSet disjointSet;
+    std::vector<int> labels;
+    int count = 0;
+};
+
+//Adjacency of a Graph flattened into offsets + targets. Graph keeps both
+//directions of every edge so the view is symmetric.
+struct CSRView {
+    CSRView(Graph &graph, int threads) {
+        int V = graph.getV();
+        offsets.resize(V + 1, 0);
+        for (int u = 0; u <= V-1; ++u) {
+            offsets[u+1] = offsets[u] + graph.getEdges(u).size();
         }
+
+        targets.resize(offsets[V]);
+        parallelFor(0, V, threads, [&](std::size_t u) {
+            std::size_t i = offsets[u];
+            for (auto &e: graph.getEdges(static_cast<int>(u))) {
+                targets[i++] = e.v;
+            }
+        });
+    }
+
+    std::size_t degree(int u) const {
+        return offsets[u+1] - offsets[u];
+    }
+
+    std::vector<std::size_t> offsets;
+    std::vector<int> targets;
+};
+
+//Afforest (Sutton et al.): link every vertex along its first few neighbors,
+//compress, then find the component most vertices already landed in by
+//sampling and skip the remaining edges of its members, so the bulk of the
+//edges of the giant component is never touched. Hooks point the larger
+//label at the smaller one with a CAS, so the final root of a component is its
+//smallest vertex id. Labels are then compacted to dense ids 0..count-1 and
+//sameComponent is a single array compare.
+class ParallelConnectedComponents {
+public:
+    static const int NEIGHBOR_ROUNDS = 2;
+    static const int SAMPLES = 1024;
+
+    ParallelConnectedComponents(Graph &graph, int threads = std::thread::hardware_concurrency()) :
+        graph(graph), threads(threads), csr(graph, threads) {
+        compute();
     }
 
     bool sameComponent(const std::string &a, const std::string &b) {
-        Node nodeA = graph.getNode(a);
-        Node nodeB = graph.getNode(b);
+        return sameComponent(graph.getNode(a).id, graph.getNode(b).id);
+    }
+
+    bool sameComponent(int a, int b) const {
+        return labels[a] == labels[b];
+    }
 
-        return disjointSet.findSet(nodeA.id)->id == disjointSet.findSet(nodeB.id)->id;
+    //Dense component id of every node, in [0, componentCount()).
+    const std::vector<int>& getLabels() const {
+        return labels;
+    }
+
+    int componentCount() const {
+        return count;
     }
 
 private:
+    void compute() {
+        int V = graph.getV();
+        std::vector<int> comp(V);
+        parallelFor(0, V, threads, [&](std::size_t u) { comp[u] = static_cast<int>(u); });
+
+        for (int r = 0; r <= NEIGHBOR_ROUNDS-1; ++r) {
+            parallelFor(0, V, threads, [&](std::size_t u) {
+                if (static_cast<std::size_t>(r) < csr.degree(u)) {
+                    link(comp, static_cast<int>(u), csr.targets[csr.offsets[u] + r]);
+                }
+            });
+            compress(comp);
+        }
+
+        int frequent = sampleFrequentComponent(comp);
+        parallelFor(0, V, threads, [&](std::size_t u) {
+            if (load(comp, static_cast<int>(u)) == frequent)
+                return;
+
+            for (std::size_t i = csr.offsets[u] + NEIGHBOR_ROUNDS; i < csr.offsets[u+1]; ++i) {
+                link(comp, static_cast<int>(u), csr.targets[i]);
+            }
+        });
+        compress(comp);
+
+        //Roots are the smallest id of their component, so a vertex is a root
+        //exactly when comp[u] == u and a serial scan numbers them in order.
+        labels.resize(V);
+        std::vector<int> dense(V, -1);
+        count = 0;
+        for (int u = 0; u <= V-1; ++u) {
+            if (comp[u] == u)
+                dense[u] = count++;
+        }
+        parallelFor(0, V, threads, [&](std::size_t u) { labels[u] = dense[comp[u]]; });
+    }
+
+    static int load(std::vector<int> &comp, int u) {
+        return std::atomic_ref<int>(comp[u]).load(std::memory_order_relaxed);
+    }
+
+    void link(std::vector<int> &comp, int u, int v) {
+        int p1 = load(comp, u);
+        int p2 = load(comp, v);
+        while (p1 != p2) {
+            int high = std::max(p1, p2);
+            int low = std::min(p1, p2);
+            int pHigh = load(comp, high);
+            if (pHigh == low)
+                break;
+
+            int expected = high;
+            if (pHigh == high && std::atomic_ref<int>(comp[high]).compare_exchange_strong(expected, low))
+                break;
+
+            p1 = load(comp, load(comp, high));
+            p2 = load(comp, low);
+        }
+    }
+
+    void compress(std::vector<int> &comp) {
+        parallelFor(0, comp.size(), threads, [&](std::size_t u) {
+            int n = static_cast<int>(u);
+            while (load(comp, n) != load(comp, load(comp, n))) {
+                std::atomic_ref<int>(comp[n]).store(load(comp, load(comp, n)), std::memory_order_relaxed);
+            }
+        });
+    }
+
+    int sampleFrequentComponent(const std::vector<int> &comp) const {
+        if (comp.empty())
+            return -1;
+
+        std::mt19937 rng(27491095);
+        std::uniform_int_distribution<int> pick(0, static_cast<int>(comp.size()) - 1);
+        std::unordered_map<int, int> counts;
+        for (int i = 0; i <= SAMPLES-1; ++i) {
+            ++counts[comp[pick(rng)]];
+        }
+
+        auto frequent = std::max_element(std::begin(counts), std::end(counts),
+            [](auto &a, auto &b) { return a.second < b.second; });
+        return frequent->first;
+    }
+
     Graph &graph;
+    int threads = 1;
+    CSRView csr;
+    std::vector<int> labels;
+    int count = 0;
+};
+
+//Connectivity over an edge stream: edges are unioned as they arrive and the
+//graph itself is never stored, so memory is O(V) however many edges stream
+//through. Every root keeps its component size, and members form a circular
+//list through next[] that two components splice in O(1) on union.
+class IncrementalConnectivity {
+public:
+    using Listener = std::function<void(int oldCount, int newCount)>;
+
+    IncrementalConnectivity(int V) : disjointSet(V), size(V, 1), next(V), count(V) {
+        for (int u = 0; u <= V-1; ++u) {
+            next[u] = u;
+        }
+    }
+
+    //Called at most once per addEdges batch, only when the count changed.
+    void onCountChanged(Listener listener) {
+        this->listener = std::move(listener);
+    }
+
+    void addEdge(int u, int v) {
+        int oldCount = count;
+        link(u, v);
+        notify(oldCount);
+    }
+
+    void addEdges(const std::vector<Edge> &batch) {
+        int oldCount = count;
+        for (auto &e: batch) {
+            link(e.u, e.v);
+        }
+        notify(oldCount);
+    }
+
+    bool sameComponent(int u, int v) {
+        return disjointSet.findSet(u) == disjointSet.findSet(v);
+    }
+
+    int componentSize(int u) {
+        return size[disjointSet.findSet(u)];
+    }
+
+    int componentCount() const {
+        return count;
+    }
+
+    std::vector<int> members(int u) const {
+        std::vector<int> result;
+        int w = u;
+        do {
+            result.emplace_back(w);
+            w = next[w];
+        } while (w != u);
+        return result;
+    }
+
+private:
+    void link(int u, int v) {
+        int ru = disjointSet.findSet(u);
+        int rv = disjointSet.findSet(v);
+        if (!disjointSet.unionSets(ru, rv))
+            return;
+
+        int root = disjointSet.findSet(ru);
+        size[root] = size[ru] + size[rv];
+        std::swap(next[ru], next[rv]);
+        --count;
+    }
+
+    void notify(int oldCount) {
+        if (listener && oldCount != count)
+            listener(oldCount, count);
+    }
+
     DisjointSet disjointSet;
-    
+    std::vector<int> size;
+    std::vector<int> next;
+    int count = 0;
+    Listener listener;
 };
 
 int main() {
@@ -192,5 +477,37 @@ int main() {
     std::cout << std::boolalpha << "a, i isSameComponent: " << cc.sameComponent("a", "i") << std::endl;
     std::cout << std::boolalpha << "i, j isSameComponent: " << cc.sameComponent("j", "i") << std::endl;
 
+    std::vector<int> from {0, 7, 0, 9};
+    std::vector<int> to {1, 8, 8, 8};
+    std::vector<std::uint8_t> same = cc.sameComponent(from, to);
+    std::cout << "Batch sameComponent:";
+    for (auto r: same) {
+        std::cout << " " << std::boolalpha << static_cast<bool>(r);
+    }
+    std::cout << std::endl;
+    std::cout << "Connected components: " << cc.componentCount() << std::endl;
+
+    ParallelConnectedComponents pcc(graph);
+    std::cout << "Parallel connected components: " << pcc.componentCount() << std::endl;
+    std::cout << std::boolalpha << "a, b isSameComponent: " << pcc.sameComponent("a", "b") << std::endl;
+    std::cout << std::boolalpha << "h, i isSameComponent: " << pcc.sameComponent("h", "i") << std::endl;
+    std::cout << std::boolalpha << "a, i isSameComponent: " << pcc.sameComponent("a", "i") << std::endl;
+    std::cout << std::boolalpha << "i, j isSameComponent: " << pcc.sameComponent("j", "i") << std::endl;
+
+    IncrementalConnectivity stream(graph.getV());
+    stream.onCountChanged([](int oldCount, int newCount) {
+        std::cout << "Component count: " << oldCount << " -> " << newCount << std::endl;
+    });
+    stream.addEdges({{0, 1}, {0, 2}, {1, 2}, {1, 3}});
+    stream.addEdges({{4, 5}, {6, 4}});
+    stream.addEdge(7, 8);
+    stream.addEdge(8, 7);
+    std::cout << "Size of a's component: " << stream.componentSize(0) << std::endl;
+    std::cout << "Members of e's component:";
+    for (int u: stream.members(4)) {
+        std::cout << " " << graph.getNode(u).data;
+    }
+    std::cout << std::endl;
+
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,149 @@
+#include <iostream>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <utility>
+
+#include "DisjointSet.h"
+
+//Offline dynamic connectivity: the whole batch of edge inserts, deletes and
+//connectivity queries is known up front. Every edge is alive over a time
+//interval of the batch, the interval is stored in the O(log q) segment tree
+//nodes covering it, and a DFS over the tree unions a node's edges on entry
+//and rolls them back on exit. At a leaf the set holds exactly the edges
+//alive at that time, so each query is two finds: O((n + q) log q log n).
+class DynamicConnectivity {
+public:
+    enum class OP {
+        ADD = 0,
+        REMOVE = 1,
+        QUERY = 2
+    };
+
+    struct Operation {
+        OP op = OP::QUERY;
+        int u = 0;
+        int v = 0;
+    };
+
+    DynamicConnectivity(int V) : V(V) {}
+
+    void addEdge(int u, int v) {
+        operations.emplace_back(Operation{OP::ADD, u, v});
+    }
+
+    void removeEdge(int u, int v) {
+        operations.emplace_back(Operation{OP::REMOVE, u, v});
+    }
+
+    void query(int u, int v) {
+        operations.emplace_back(Operation{OP::QUERY, u, v});
+    }
+
+    //Answers of the recorded queries, in the order they were recorded.
+    std::vector<bool> solve() {
+        int T = static_cast<int>(operations.size());
+        tree.assign(4 * std::max(T, 1), std::vector<std::pair<int, int>>());
+
+        std::unordered_map<std::uint64_t, std::vector<int>> alive;
+        for (int t = 0; t <= T-1; ++t) {
+            const Operation &op = operations[t];
+            if (op.op == OP::ADD) {
+                alive[key(op.u, op.v)].emplace_back(t);
+            }
+            else if (op.op == OP::REMOVE) {
+                auto itr = alive.find(key(op.u, op.v));
+                if (itr == alive.end() || itr->second.empty())
+                    continue;
+
+                insert(1, 0, T-1, itr->second.back(), t, {op.u, op.v});
+                itr->second.pop_back();
+            }
+        }
+
+        for (auto &[k, starts]: alive) {
+            int u = static_cast<int>(k >> 32);
+            int v = static_cast<int>(k & 0xffffffff);
+            for (int start: starts) {
+                insert(1, 0, T-1, start, T-1, {u, v});
+            }
+        }
+
+        std::vector<bool> answers;
+        if (T > 0) {
+            RollbackDisjointSet disjointSet(V);
+            dfs(1, 0, T-1, disjointSet, answers);
+        }
+        return answers;
+    }
+
+private:
+    static std::uint64_t key(int u, int v) {
+        if (u > v)
+            std::swap(u, v);
+        return (static_cast<std::uint64_t>(u) << 32) | static_cast<std::uint32_t>(v);
+    }
+
+    void insert(int node, int lo, int hi, int from, int to, std::pair<int, int> edge) {
+        if (to < lo || hi < from)
+            return;
+
+        if (from <= lo && hi <= to) {
+            tree[node].emplace_back(edge);
+            return;
+        }
+
+        int mid = (lo + hi) / 2;
+        insert(2*node, lo, mid, from, to, edge);
+        insert(2*node+1, mid+1, hi, from, to, edge);
+    }
+
+    void dfs(int node, int lo, int hi, RollbackDisjointSet &disjointSet, std::vector<bool> &answers) {
+        std::size_t mark = disjointSet.snapshot();
+        for (auto &[u, v]: tree[node]) {
+            disjointSet.unionSets(u, v);
+        }
+
+        if (lo == hi) {
+            const Operation &op = operations[lo];
+            if (op.op == OP::QUERY) {
+                answers.emplace_back(disjointSet.findSet(op.u) == disjointSet.findSet(op.v));
+            }
+        }
+        else {
+            int mid = (lo + hi) / 2;
+            dfs(2*node, lo, mid, disjointSet, answers);
+            dfs(2*node+1, mid+1, hi, disjointSet, answers);
+        }
+
+        disjointSet.rollback(mark);
+    }
+
+    int V = 0;
+    std::vector<Operation> operations;
+    std::vector<std::vector<std::pair<int, int>>> tree;
+};
+
+int main() {
+    std::cout << "Dynamic connectivity (offline)" << std::endl;
+
+    DynamicConnectivity connectivity(5);
+    connectivity.addEdge(0, 1);
+    connectivity.addEdge(1, 2);
+    connectivity.query(0, 2);
+    connectivity.removeEdge(1, 2);
+    connectivity.query(0, 2);
+    connectivity.addEdge(2, 3);
+    connectivity.addEdge(3, 0);
+    connectivity.query(1, 2);
+    connectivity.removeEdge(0, 1);
+    connectivity.query(1, 2);
+    connectivity.query(0, 2);
+    connectivity.query(4, 0);
+
+    for (bool connected: connectivity.solve()) {
+        std::cout << std::boolalpha << connected << std::endl;
+    }
+
+    return 0;
+}
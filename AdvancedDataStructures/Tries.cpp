@@ -1,55 +1,234 @@
 #include <iostream>
 #include <vector>
-#include <memory>
+#include <string>
+#include <cstdint>
+#include <fstream>
+#include <random>
+#include <unistd.h>
 
 const int SIZE = 26;
 
+//Nodes live in one contiguous arena and refer to their children by index,
+//index 0 is the root and can never be a child so it doubles as "no child".
+//A freed node keeps the next free index in children[0].
 struct TrieNode {
-    using Ptr = std::shared_ptr<TrieNode>;
-    TrieNode():
-        children(SIZE, TrieNode::Ptr()) {
+    using Index = std::uint32_t;
 
-    }
-    std::vector<TrieNode::Ptr> children;
+    Index children[SIZE] = {};
+    std::uint8_t count = 0;
     bool end = false;
 };
 
+inline void prefetch(const void *ptr) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(ptr, 0, 1);
+#endif
+}
+
 struct Trie {
-    Trie () : 
-        rootPtr(std::make_shared<TrieNode>()) {
-        
+    //Number of keys kept in flight by the batch find, enough independent
+    //misses to cover memory latency while the lane state stays in L1.
+    static const int LANES = 16;
+
+    Trie () {
+        nodes.emplace_back();
     }
+
     void insert(const std::string &key) {
-        TrieNode::Ptr ptr = rootPtr;
+        TrieNode::Index ptr = 0;
         for (auto ch : key) {
             int index  = ch - 'a';
-            if (ptr->children[index]) {
-                ptr = ptr->children[index];
-            }
-            else {
-                ptr->children[index] = std::make_shared<TrieNode>();
-                ptr = ptr->children[index];
+            if (!nodes[ptr].children[index]) {
+                TrieNode::Index child = allocate();
+                nodes[ptr].children[index] = child;
+                ++nodes[ptr].count;
             }
+            ptr = nodes[ptr].children[index];
+        }
+        nodes[ptr].end = true;
+    }
+
+    bool find(const std::string &key) const {
+        TrieNode::Index ptr = 0;
+        for (auto ch : key) {
+            int index  = ch - 'a';
+            if (!nodes[ptr].children[index])
+                return false;
+
+            ptr = nodes[ptr].children[index];
         }
-        ptr->end = true;
+
+        return nodes[ptr].end;
     }
 
-    bool find(const std::string &key) {
-        TrieNode::Ptr ptr = rootPtr;
+    //Removes key and prunes the branch that no longer leads to any key, the
+    //pruned nodes go back to the free list for the next insert.
+    bool erase(const std::string &key) {
+        path.clear();
+        TrieNode::Index ptr = 0;
         for (auto ch : key) {
             int index  = ch - 'a';
-            if (!ptr->children[index])
+            if (!nodes[ptr].children[index])
                 return false;
-            
-            ptr = ptr->children[index];
+
+            path.emplace_back(ptr);
+            ptr = nodes[ptr].children[index];
         }
 
-        return ptr->end;
+        if (!nodes[ptr].end)
+            return false;
+
+        nodes[ptr].end = false;
+        for (std::size_t depth = key.size(); depth > 0; --depth) {
+            if (nodes[ptr].end || nodes[ptr].count)
+                break;
+
+            TrieNode::Index parent = path[depth-1];
+            nodes[parent].children[key[depth-1] - 'a'] = 0;
+            --nodes[parent].count;
+            release(ptr);
+            ptr = parent;
+        }
+        return true;
+    }
+
+    std::size_t liveNodes() const {
+        return nodes.size() - freeNodes;
+    }
+
+    std::size_t arenaNodes() const {
+        return nodes.size();
     }
 
-    TrieNode::Ptr rootPtr;
+    //Batch find: walks up to LANES keys in lock-step, one trie level per
+    //round, prefetching the child slot each lane reads next round. A lane that
+    //finishes is refilled with the next pending key so all lanes stay busy.
+    std::vector<bool> find(const std::vector<std::string> &keys) const {
+        std::vector<bool> found(keys.size(), false);
+
+        struct Lane {
+            std::size_t key = 0;
+            std::size_t depth = 0;
+            TrieNode::Index node = 0;
+        };
+        Lane lanes[LANES];
+        int active = 0;
+        std::size_t next = 0;
+
+        auto prefetchSlot = [&](const Lane &lane) {
+            prefetch(&nodes[lane.node].children[keys[lane.key][lane.depth] - 'a']);
+        };
+
+        auto fill = [&](Lane &lane) {
+            while (next < keys.size()) {
+                lane = Lane{next++, 0, 0};
+                if (!keys[lane.key].empty()) {
+                    prefetchSlot(lane);
+                    return true;
+                }
+                found[lane.key] = nodes[0].end;
+            }
+            return false;
+        };
+
+        while (active < LANES && fill(lanes[active])) {
+            ++active;
+        }
+
+        while (active > 0) {
+            for (int i = 0; i < active; ) {
+                Lane &lane = lanes[i];
+                const std::string &key = keys[lane.key];
+                TrieNode::Index child = nodes[lane.node].children[key[lane.depth] - 'a'];
+                ++lane.depth;
+
+                if (child && lane.depth < key.size()) {
+                    lane.node = child;
+                    prefetchSlot(lane);
+                    ++i;
+                    continue;
+                }
+
+                found[lane.key] = child && nodes[child].end;
+                if (!fill(lane)) {
+                    lane = lanes[--active];
+                }
+                else {
+                    ++i;
+                }
+            }
+        }
+
+        return found;
+    }
+
+private:
+    TrieNode::Index allocate() {
+        if (freeHead) {
+            TrieNode::Index index = freeHead;
+            freeHead = nodes[index].children[0];
+            nodes[index] = TrieNode();
+            --freeNodes;
+            return index;
+        }
+        nodes.emplace_back();
+        return static_cast<TrieNode::Index>(nodes.size() - 1);
+    }
+
+    void release(TrieNode::Index index) {
+        nodes[index].children[0] = freeHead;
+        freeHead = index;
+        ++freeNodes;
+    }
+
+    std::vector<TrieNode> nodes;
+    std::vector<TrieNode::Index> path;
+    TrieNode::Index freeHead = 0;
+    std::size_t freeNodes = 0;
 };
 
+long residentKB() {
+    long pages = 0, resident = 0;
+    std::ifstream statm("/proc/self/statm");
+    statm >> pages >> resident;
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+//Keeps a fixed working set of keys and replaces a slice of it every round,
+//with node reclamation the arena and RSS level off after the first rounds.
+void churnBenchmark() {
+    const int KEYS = 200000;
+    const int ROUNDS = 10;
+    std::mt19937 rng(42);
+    auto randomKey = [&]() {
+        std::string key(4 + rng() % 8, 'a');
+        for (auto &ch : key) {
+            ch = static_cast<char>('a' + rng() % SIZE);
+        }
+        return key;
+    };
+
+    Trie trie;
+    std::vector<std::string> live(KEYS);
+    for (auto &key : live) {
+        key = randomKey();
+        trie.insert(key);
+    }
+
+    std::cout << "Churn benchmark (" << KEYS << " live keys, half replaced per round):" << std::endl;
+    for (int round = 1; round <= ROUNDS; ++round) {
+        for (int i = 0; i < KEYS/2; ++i) {
+            std::string &key = live[rng() % KEYS];
+            trie.erase(key);
+            key = randomKey();
+            trie.insert(key);
+        }
+        std::cout << "round " << round << ": live nodes " << trie.liveNodes()
+                  << ", arena nodes " << trie.arenaNodes()
+                  << ", rss " << residentKB() << " KB" << std::endl;
+    }
+}
+
 int main() {
     std::cout << "Tries example" << std::endl;
     Trie trie;
@@ -66,6 +245,21 @@ int main() {
     std::cout << std::boolalpha << trie.find("these") << std::endl;
     std::cout << std::boolalpha << trie.find("their") << std::endl;
     std::cout << std::boolalpha << trie.find("thaw") << std::endl;
-    
+
+    std::vector<std::string> keys {"the", "these", "their", "thaw", "a", "an", "any", "bye", ""};
+    std::vector<bool> found = trie.find(keys);
+    std::cout << "Batch find:" << std::endl;
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        std::cout << "\"" << keys[i] << "\": " << std::boolalpha << found[i] << std::endl;
+    }
+
+    trie.erase("the");
+    trie.erase("answer");
+    std::cout << std::boolalpha << trie.find("the") << std::endl;
+    std::cout << std::boolalpha << trie.find("there") << std::endl;
+    std::cout << std::boolalpha << trie.find("any") << std::endl;
+
+    churnBenchmark();
+
     return 0;
-}
\ No newline at end of file
+}
@@ -1,44 +1,251 @@
 #include <iostream>
 #include <vector>
+#include <string>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <new>
+#include <cstdlib>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <queue>
+#include <array>
+#include <functional>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
 
+#include "CSRGraph.h"
+#include "PriorityQueues.h"
+#include "ThreadPool.h"
+
+//Square matrix in one 64-byte aligned allocation. Rows are padded to a
+//multiple of TILE elements, so every tile row starts on a cache line and
+//tiles never straddle the matrix edge.
+template <typename T>
+class Matrix {
+public:
+    static const int TILE = 64;
+
+    Matrix(int V, T fill) : n((V + TILE - 1) / TILE * TILE) {
+        std::size_t bytes = static_cast<std::size_t>(n) * n * sizeof(T);
+        data.reset(static_cast<T*>(std::aligned_alloc(64, (bytes + 63) / 64 * 64)));
+        if (!data && bytes > 0)
+            throw std::bad_alloc();
+        std::fill(data.get(), data.get() + static_cast<std::size_t>(n) * n, fill);
+    }
+
+    //Padded size, a multiple of TILE.
+    int size() const {
+        return n;
+    }
+
+    T* row(int i) {
+        return data.get() + static_cast<std::size_t>(i) * n;
+    }
+
+    const T* row(int i) const {
+        return data.get() + static_cast<std::size_t>(i) * n;
+    }
+
+    T& operator() (int i, int j) {
+        return row(i)[j];
+    }
+
+    T operator() (int i, int j) const {
+        return row(i)[j];
+    }
+
+private:
+    struct Free {
+        void operator() (T *p) const { std::free(p); }
+    };
+
+    int n = 0;
+    std::unique_ptr<T[], Free> data;
+};
+
+//All-pairs shortest paths table over distances of type Weight (int16_t,
+//int32_t or int64_t). INF is the type's maximum and sums saturate: INF plus
+//anything stays INF and a sum that does not fit clamps to the type's range.
+//Weights are never narrowed: the CSR arcs keep them as Weight, and Johnson
+//sums in long long and clamps only the final distance. Floyd-Warshall clamps
+//every partial sum, which agrees unless negative arcs bring a path back
+//into range after a prefix of it left it.
+//
+//Storage decides what is kept next to the V x V distances:
+//  adjacencyMatrix  false frees the V x V arc matrix once the table is
+//                   initialized and keeps the arcs as a CSR instead.
+//  predecessors     false drops the V x V predecessor matrix; path() and
+//                   predecessor() then re-derive every next hop u -> x as an
+//                   arc with w(u, x) + distance(x, v) == distance(u, v).
+//With both off and int32_t distances the table needs a third of the memory
+//of the full layout, with int16_t a sixth.
+template <typename Weight = int>
 class FloydWarshall {
 public:
-    FloydWarshall (int V) : V(V) {
-        adjMatrix.resize(V, std::vector<int>(V, 0));
-        shortestPathWights.resize(V, std::vector<int>(V, INF));
-        predecessors.resize(V, std::vector<int>(V, -1));
+    //AUTO runs Johnson's algorithm when E / V^2 is at most
+    //JOHNSON_MAX_DENSITY and Floyd-Warshall otherwise.
+    enum class METHOD {
+        AUTO = 0,
+        FLOYD_WARSHALL = 1,
+        JOHNSON = 2
+    };
+    static constexpr double JOHNSON_MAX_DENSITY = 0.05;
+    static constexpr Weight INF = std::numeric_limits<Weight>::max();
+
+    struct Storage {
+        bool adjacencyMatrix = true;
+        bool predecessors = true;
+    };
+
+    //Tiles, rows and Johnson's sources run on pool, which the caller owns and
+    //may share between tables.
+    FloydWarshall (int V, ThreadPool &pool, Storage storage = {}) :
+        V(V), storage(storage), adjMatrix(std::make_unique<Matrix<Weight>>(V, INF)), shortestPathWights(V, INF),
+        pool(pool) {
+        if (storage.predecessors)
+            predecessors = std::make_unique<Matrix<int>>(V, -1);
     }
 
-    void addEdge(int u, int v, int w) {
-        adjMatrix[u][v] = w;
+    //Table over the arcs of a CSR, e.g. one made by GraphLoader.
+    FloydWarshall (const CSRGraph &csr, ThreadPool &pool, Storage storage = {}) :
+        FloydWarshall(csr.getV(), pool, storage) {
+        if (!csr.weighted() && csr.getE() > 0)
+            throw std::runtime_error("Shortest paths need a weighted graph");
+
+        for (int u = 0; u <= V-1; ++u) {
+            for (std::size_t arc = csr.begin(u); arc < csr.end(u); ++arc) {
+                addEdge(u, csr.target(arc), csr.weight(arc));
+            }
+        }
+    }
+
+    //Of parallel arcs only the lightest matters. As in updateEdge, a
+    //negative self-loop throws and any other self-loop is ignored.
+    void addEdge(int u, int v, Weight w) {
+        if (!adjMatrix)
+            throw std::runtime_error("Adjacency matrix was dropped, arcs can no longer be added");
+        if (u == v) {
+            if (w < 0)
+                throw std::runtime_error("Edge creates a negative cycle");
+            return;
+        }
+
+        (*adjMatrix)(u, v) = std::min((*adjMatrix)(u, v), w);
+        ++E;
     }
 
-    void compute() {
+    void compute(METHOD method = METHOD::AUTO) {
+        computed = true;
+        if (method == METHOD::AUTO) {
+            double density = static_cast<double>(E) / (static_cast<double>(V) * V);
+            method = density <= JOHNSON_MAX_DENSITY ? METHOD::JOHNSON : METHOD::FLOYD_WARSHALL;
+        }
+
         initialize();
+        if (method == METHOD::JOHNSON && johnson())
+            return;
+
+        //Blocked Floyd-Warshall (Venkataraman et al.): for every k-tile the
+        //diagonal tile goes first, then the tiles in its row and column,
+        //which only depend on it, then all remaining tiles, which only
+        //depend on those. Tiles of one phase are independent of each other
+        //and run on the pool.
+        int tiles = shortestPathWights.size() / TILE;
+        for (int kt = 0; kt <= tiles-1; ++kt) {
+            tile(kt, kt, kt);
+            pool.parallelFor(0, 2 * tiles, [&](std::size_t t) {
+                int other = static_cast<int>(t) % tiles;
+                if (other == kt)
+                    return;
+                if (static_cast<int>(t) < tiles)
+                    tile(kt, other, kt);
+                else
+                    tile(other, kt, kt);
+            }, 1);
+            pool.parallelFor(0, static_cast<std::size_t>(tiles) * tiles, [&](std::size_t t) {
+                int it = static_cast<int>(t / tiles);
+                int jt = static_cast<int>(t % tiles);
+                if (it != kt && jt != kt)
+                    tile(it, jt, kt);
+            }, 1);
+        }
+    }
+
+    //Sets the weight of arc u -> v, adding it if missing, and repairs the
+    //computed table in place:
+    //  lower weight   every pair may now route through the arc, one
+    //                 O(V^2) pass of d(i, j) = min(d(i, j), d(i, u) + w + d(v, j)).
+    //  higher weight  only rows whose shortest path to v used the arc
+    //                 (d(i, u) + w_old == d(i, v)) can change. Each is redone
+    //                 by Dijkstra with its old row as potential: weights only
+    //                 grew, so w + old[x] - old[y] is never negative.
+    //Throws when a lower weight would close a negative cycle, leaving the
+    //table untouched. A negative self-loop is such a cycle, any other
+    //self-loop never shortens a path and is ignored.
+    void updateEdge(int u, int v, Weight w) {
+        if (u == v) {
+            if (w < 0)
+                throw std::runtime_error("Edge update creates a negative cycle");
+            return;
+        }
+
+        Weight old = arcWeight(u, v);
+        if (w == old)
+            return;
+        if (computed && w < old && add(shortestPathWights(v, u), w) < 0)
+            throw std::runtime_error("Edge update creates a negative cycle");
 
-        for (int k = 0; k <= V-1; ++k) {
+        std::vector<int> affected;
+        if (computed && w > old) {
             for (int i = 0; i <= V-1; ++i) {
+                if (shortestPathWights(i, u) != INF && add(shortestPathWights(i, u), old) == shortestPathWights(i, v))
+                    affected.emplace_back(i);
+            }
+        }
+
+        setArc(u, v, w);
+        if (!computed)
+            return;
+
+        if (w < old) {
+            pool.parallelFor(0, V, [&](std::size_t row) {
+                int i = static_cast<int>(row);
+                Weight via = add(shortestPathWights(i, u), w);
+                if (via == INF)
+                    return;
+
+                Weight *d = shortestPathWights.row(i);
+                const Weight *dv = shortestPathWights.row(v);
                 for (int j = 0; j <= V-1; ++j) {
-                    if (shortestPathWights[i][k] + shortestPathWights[k][j] < shortestPathWights[i][j]) {
-                        shortestPathWights[i][j] = shortestPathWights[i][k] + shortestPathWights[k][j];   
-                        predecessors[i][j] = predecessors[k][j];
-                    }
-                    else {
-                        shortestPathWights[i][j] = shortestPathWights[i][j];
-                        predecessors[i][j] = predecessors[i][j];
+                    Weight candidate = add(via, dv[j]);
+                    if (candidate < d[j]) {
+                        d[j] = candidate;
+                        if (predecessors)
+                            (*predecessors)(i, j) = j == v ? u : (*predecessors)(v, j);
                     }
                 }
-            }
-
+            }, 16);
+            return;
         }
 
+        pool.parallelFor(0, affected.size(), [&](std::size_t a) {
+            recomputeRow(affected[a]);
+        }, 1);
     }
 
     void print() {
         std::cout << "Shortest path wights: " << std::endl;
         for (int i = 0; i <= V-1; ++i) {
             for (int j = 0; j <= V-1; ++j) {
-                std::cout << shortestPathWights[i][j] << " ";
+                if (shortestPathWights(i, j) == INF)
+                    std::cout << "INF ";
+                else
+                    std::cout << static_cast<long long>(shortestPathWights(i, j)) << " ";
             }
             std::cout << std::endl;
         }
@@ -46,40 +253,611 @@ public:
         std::cout << "Shortest path predecessor: " << std::endl;
         for (int i = 0; i <= V-1; ++i) {
             for (int j = 0; j <= V-1; ++j) {
-                std::cout << predecessors[i][j] << " ";
+                std::cout << predecessor(i, j) << " ";
             }
             std::cout << std::endl;
         }
     }
 
-     
+    Weight distance(int u, int v) const {
+        return shortestPathWights(u, v);
+    }
+
+    //Vertex before v on a shortest path from u, -1 for u itself and for
+    //vertices u cannot reach.
+    int predecessor(int u, int v) const {
+        if (predecessors)
+            return (*predecessors)(u, v);
+
+        std::vector<int> hops = path(u, v);
+        return hops.size() >= 2 ? hops[hops.size() - 2] : -1;
+    }
+
+    //Vertices of a shortest path from u to v, empty when there is none.
+    std::vector<int> path(int u, int v) const {
+        std::vector<int> hops;
+        if (shortestPathWights(u, v) == INF)
+            return hops;
+
+        //Both walks only follow arcs that lie on shortest paths, but with
+        //zero-weight cycles they can run in circles (the tiled order can leave
+        //such a cycle in the predecessors), then a BFS over the tight arcs
+        //finds a simple path.
+        std::vector<char> seen(V, 0);
+        if (predecessors) {
+            for (int x = v; x != u; x = (*predecessors)(u, x)) {
+                if (x == -1 || seen[x])
+                    return tightPath(u, v);
+                seen[x] = 1;
+                hops.emplace_back(x);
+            }
+            hops.emplace_back(u);
+            std::reverse(std::begin(hops), std::end(hops));
+            return hops;
+        }
+
+        hops.emplace_back(u);
+        seen[u] = 1;
+        for (int x = u; x != v; ) {
+            x = nextHop(x, v);
+            if (x == -1 || seen[x])
+                return tightPath(u, v);
+            seen[x] = 1;
+            hops.emplace_back(x);
+        }
+        return hops;
+    }
+
+    //Bytes held by the table's matrices and arcs.
+    std::size_t bytes() const {
+        std::size_t n = static_cast<std::size_t>(shortestPathWights.size()) * shortestPathWights.size();
+        std::size_t total = n * sizeof(Weight);
+        if (adjMatrix)
+            total += n * sizeof(Weight);
+        if (predecessors)
+            total += n * sizeof(int);
+        total += arcs.offsetArray().size_bytes() + arcs.targetArray().size_bytes() + arcWeights.size() * sizeof(Weight);
+        return total;
+    }
 
 private:
+    struct Edge {
+        int u = 0;
+        int v = 0;
+        Weight w = 0;
+    };
+
+    static const int TILE = Matrix<Weight>::TILE;
+
+    static Weight add(Weight a, Weight b) {
+        if (a == INF || b == INF)
+            return INF;
+
+        Weight sum;
+        if (__builtin_add_overflow(a, b, &sum))
+            return a > 0 ? INF : std::numeric_limits<Weight>::min();
+        return sum;
+    }
+
+    //add() for the long long potentials and distances of Johnson and
+    //recomputeRow, which sum weights beyond Weight's range.
+    static long long wideAdd(long long a, long long b) {
+        long long sum;
+        if (__builtin_add_overflow(a, b, &sum))
+            return a > 0 ? std::numeric_limits<long long>::max() : std::numeric_limits<long long>::min();
+        return sum;
+    }
+
+    static long long wideSub(long long a, long long b) {
+        long long difference;
+        if (__builtin_sub_overflow(a, b, &difference))
+            return b < 0 ? std::numeric_limits<long long>::max() : std::numeric_limits<long long>::min();
+        return difference;
+    }
+
+    //Out-arcs of u as (target, weight), from whichever adjacency is kept.
+    template <typename F>
+    void forEachArc(int u, F f) const {
+        if (adjMatrix) {
+            const Weight *row = adjMatrix->row(u);
+            for (int v = 0; v <= V-1; ++v) {
+                if (row[v] != INF && v != u)
+                    f(v, row[v]);
+            }
+        }
+        else {
+            for (std::size_t arc = arcs.begin(u); arc < arcs.end(u); ++arc) {
+                f(arcs.target(arc), arcWeights[arc]);
+            }
+        }
+    }
+
+    Weight arcWeight(int u, int v) const {
+        Weight weight = INF;
+        forEachArc(u, [&](int x, Weight w) {
+            if (x == v)
+                weight = std::min(weight, w);
+        });
+        return weight;
+    }
+
+    //The CSR is immutable, so without the adjacency matrix an arc change
+    //rebuilds it, O(E) next to the O(V^2) repair.
+    void setArc(int u, int v, Weight w) {
+        if (adjMatrix) {
+            E += (*adjMatrix)(u, v) == INF;
+            (*adjMatrix)(u, v) = w;
+            return;
+        }
+
+        std::vector<Edge> edges = arcList();
+        auto arc = std::find_if(std::begin(edges), std::end(edges), [&](const Edge &e) { return e.u == u && e.v == v; });
+        if (arc != std::end(edges)) {
+            arc->w = w;
+        }
+        else {
+            edges.emplace_back(Edge{u, v, w});
+            ++E;
+        }
+        arcs = csrOf(edges, arcWeights, [](const Edge &e) { return e.w; });
+    }
+
+    std::vector<Edge> arcList() const {
+        std::vector<Edge> edges;
+        for (int u = 0; u <= V-1; ++u) {
+            forEachArc(u, [&](int v, Weight w) {
+                edges.emplace_back(Edge{u, v, w});
+            });
+        }
+        return edges;
+    }
+
+    //CSRGraph only holds int weights, so the CSR is built from the bare
+    //(u, v) pairs and weightOf(edge) is stored in weights at the edge's arc
+    //index. The counting sort keeps every vertex's arcs in edge order, which
+    //replaying the per-vertex cursors reproduces.
+    template <typename T, typename F>
+    CSRGraph csrOf(const std::vector<Edge> &edges, std::vector<T> &weights, F weightOf) const {
+        struct Pair {
+            int u = 0;
+            int v = 0;
+        };
+        std::vector<Pair> pairs;
+        pairs.reserve(edges.size());
+        for (auto &e: edges) {
+            pairs.emplace_back(Pair{e.u, e.v});
+        }
+        CSRGraph csr(V, pairs);
+
+        std::vector<std::size_t> next(V);
+        for (int u = 0; u <= V-1; ++u) {
+            next[u] = csr.begin(u);
+        }
+        weights.resize(edges.size());
+        for (auto &e: edges) {
+            weights[next[e.u]++] = weightOf(e);
+        }
+        return csr;
+    }
+
+    //Single-source shortest paths from i after arc weights grew, see
+    //updateEdge. Vertices i could not reach stay unreachable.
+    void recomputeRow(int i) {
+        Weight *d = shortestPathWights.row(i);
+        std::vector<Weight> old(d, d + V);
+        std::vector<long long> reduced(V, std::numeric_limits<long long>::max());
+        std::vector<int> parent(V, -1);
+        std::priority_queue<std::pair<long long, int>, std::vector<std::pair<long long, int>>, std::greater<>> queue;
+
+        reduced[i] = 0;
+        queue.emplace(0, i);
+        while (!queue.empty()) {
+            auto [key, x] = queue.top();
+            queue.pop();
+            if (key != reduced[x])
+                continue;
+
+            forEachArc(x, [&](int y, Weight w) {
+                long long candidate = wideAdd(key, wideSub(wideAdd(old[x], w), old[y]));
+                if (candidate < reduced[y]) {
+                    reduced[y] = candidate;
+                    parent[y] = x;
+                    queue.emplace(candidate, y);
+                }
+            });
+        }
+
+        for (int y = 0; y <= V-1; ++y) {
+            d[y] = old[y] == INF || reduced[y] == std::numeric_limits<long long>::max() ? INF : clamp(wideAdd(reduced[y], old[y]));
+        }
+        if (predecessors) {
+            std::copy(std::begin(parent), std::end(parent), predecessors->row(i));
+        }
+    }
+
+    int nextHop(int u, int v) const {
+        int next = -1;
+        Weight target = shortestPathWights(u, v);
+        forEachArc(u, [&](int x, Weight w) {
+            if (next == -1 && add(w, shortestPathWights(x, v)) == target)
+                next = x;
+        });
+        return next;
+    }
+
+    //Fewest-hop path from u to v over arcs that lie on shortest paths to v.
+    std::vector<int> tightPath(int u, int v) const {
+        std::vector<int> from(V, -2);
+        std::vector<int> queue {u};
+        from[u] = -1;
+        for (std::size_t head = 0; head < queue.size() && from[v] == -2; ++head) {
+            int x = queue[head];
+            Weight target = shortestPathWights(x, v);
+            forEachArc(x, [&](int y, Weight w) {
+                if (from[y] == -2 && add(w, shortestPathWights(y, v)) == target) {
+                    from[y] = x;
+                    queue.emplace_back(y);
+                }
+            });
+        }
+        if (from[v] == -2)
+            throw std::runtime_error("No simple shortest path");
+
+        std::vector<int> hops;
+        for (int x = v; x != -1; x = from[x]) {
+            hops.emplace_back(x);
+        }
+        std::reverse(std::begin(hops), std::end(hops));
+        return hops;
+    }
+
+    //Loads the arcs into the distance (and predecessor) matrix. Without the
+    //adjacency matrix the arcs move into a CSR here, and the matrix is freed.
     void initialize() {
+        if (adjMatrix && !storage.adjacencyMatrix) {
+            arcs = csrOf(arcList(), arcWeights, [](const Edge &e) { return e.w; });
+            adjMatrix.reset();
+        }
+
         for (int i = 0; i <= V-1; ++i) {
-            for (int j = 0; j <= V-1; ++j) {
-                if (adjMatrix[i][j]) {
-                    shortestPathWights[i][j] = adjMatrix[i][j];
-                    predecessors[i][j] = i;
+            Weight *d = shortestPathWights.row(i);
+            std::fill(d, d + V, INF);
+            if (predecessors) {
+                std::fill(predecessors->row(i), predecessors->row(i) + V, -1);
+            }
+            forEachArc(i, [&](int j, Weight w) {
+                d[j] = w;
+                if (predecessors)
+                    (*predecessors)(i, j) = i;
+            });
+            d[i] = 0;
+        }
+    }
+
+    //Relaxes tile (it, jt) through the vertices of tile kt.
+    void tile(int it, int jt, int kt) {
+        for (int k = kt * TILE; k <= (kt + 1) * TILE - 1; ++k) {
+            const Weight *dk = shortestPathWights.row(k) + jt * TILE;
+            const int *pk = predecessors ? predecessors->row(k) + jt * TILE : nullptr;
+            for (int i = it * TILE; i <= (it + 1) * TILE - 1; ++i) {
+                Weight dik = shortestPathWights(i, k);
+                if (dik == INF)
+                    continue;
+
+                int *p = predecessors ? predecessors->row(i) + jt * TILE : nullptr;
+                relaxRow(shortestPathWights.row(i) + jt * TILE, p, dk, pk, dik);
+            }
+        }
+    }
+
+    //d[j] = min(d[j], dik + dk[j]) over one tile row, taking the
+    //predecessor from row k where that improves when predecessors are kept.
+    void relaxRow(Weight *d, int *p, const Weight *dk, const int *pk, Weight dik) const {
+#if defined(__AVX2__)
+        if constexpr (std::is_same_v<Weight, std::int32_t>) {
+            const __m256i ik = _mm256_set1_epi32(dik);
+            const __m256i inf = _mm256_set1_epi32(INF);
+            //A sum overflows only when both operands have dik's sign.
+            const __m256i saturated = _mm256_set1_epi32(dik > 0 ? INF : std::numeric_limits<Weight>::min());
+            for (int j = 0; j < TILE; j += 8) {
+                __m256i kj = _mm256_load_si256(reinterpret_cast<const __m256i*>(dk + j));
+                __m256i ij = _mm256_load_si256(reinterpret_cast<const __m256i*>(d + j));
+                __m256i via = _mm256_add_epi32(ik, kj);
+                __m256i overflow = _mm256_srai_epi32(
+                    _mm256_and_si256(_mm256_xor_si256(ik, via), _mm256_xor_si256(kj, via)), 31);
+                via = _mm256_blendv_epi8(via, saturated, overflow);
+                __m256i better = _mm256_andnot_si256(_mm256_cmpeq_epi32(kj, inf), _mm256_cmpgt_epi32(ij, via));
+                _mm256_store_si256(reinterpret_cast<__m256i*>(d + j), _mm256_blendv_epi8(ij, via, better));
+
+                if (p) {
+                    __m256i pij = _mm256_load_si256(reinterpret_cast<const __m256i*>(p + j));
+                    __m256i pkj = _mm256_load_si256(reinterpret_cast<const __m256i*>(pk + j));
+                    _mm256_store_si256(reinterpret_cast<__m256i*>(p + j), _mm256_blendv_epi8(pij, pkj, better));
                 }
-                if (i==j) {
-                    shortestPathWights[i][j] = 0;
+            }
+            return;
+        }
+        if constexpr (std::is_same_v<Weight, std::int16_t>) {
+            //adds saturates by itself, 16 distances per vector and their
+            //predecessor masks widened to two vectors of 8.
+            const __m256i ik = _mm256_set1_epi16(dik);
+            const __m256i inf = _mm256_set1_epi16(INF);
+            for (int j = 0; j < TILE; j += 16) {
+                __m256i kj = _mm256_load_si256(reinterpret_cast<const __m256i*>(dk + j));
+                __m256i ij = _mm256_load_si256(reinterpret_cast<const __m256i*>(d + j));
+                __m256i via = _mm256_adds_epi16(ik, kj);
+                __m256i better = _mm256_andnot_si256(_mm256_cmpeq_epi16(kj, inf), _mm256_cmpgt_epi16(ij, via));
+                _mm256_store_si256(reinterpret_cast<__m256i*>(d + j), _mm256_blendv_epi8(ij, via, better));
+
+                if (p) {
+                    __m256i low = _mm256_cvtepi16_epi32(_mm256_castsi256_si128(better));
+                    __m256i high = _mm256_cvtepi16_epi32(_mm256_extracti128_si256(better, 1));
+                    for (int half = 0; half <= 1; ++half) {
+                        auto *pij = reinterpret_cast<__m256i*>(p + j + 8 * half);
+                        auto *pkj = reinterpret_cast<const __m256i*>(pk + j + 8 * half);
+                        _mm256_store_si256(pij, _mm256_blendv_epi8(_mm256_load_si256(pij), _mm256_load_si256(pkj),
+                                                                   half ? high : low));
+                    }
                 }
             }
+            return;
+        }
+#endif
+        for (int j = 0; j < TILE; ++j) {
+            Weight via = add(dik, dk[j]);
+            bool better = via < d[j];
+            d[j] = better ? via : d[j];
+            if (p)
+                p[j] = better ? pk[j] : p[j];
         }
     }
 
-    int V = 0;
-    std::vector<std::vector<int>> adjMatrix;
-    std::vector<std::vector<int>> shortestPathWights;
-    std::vector<std::vector<int>> predecessors;
+    //Johnson's algorithm, O(V E log V) instead of O(V^3) on sparse graphs.
+    //Bellman-Ford from a virtual source with a 0 arc to every vertex gives
+    //potentials h, reweighting every arc to w + h[u] - h[v] makes all weights
+    //non-negative without changing which paths are shortest, and a Dijkstra
+    //per source then runs on the pool threads, each filling its own rows.
+    //Returns false on a negative cycle, which leaves the work to
+    //Floyd-Warshall so it shows up on the diagonal as before.
+    //Potentials, reweighted arcs and distances are long long with saturating
+    //sums, so no Weight is narrowed and a path too long for Weight clamps
+    //like it does in relaxRow.
+    bool johnson() {
+        std::vector<Edge> edges = arcList();
+        std::vector<long long> h(V, 0);
+        bool changed = true;
+        for (int pass = 1; pass <= V && changed; ++pass) {
+            changed = false;
+            for (auto &e: edges) {
+                long long hv = wideAdd(h[e.u], e.w);
+                if (hv < h[e.v]) {
+                    h[e.v] = hv;
+                    changed = true;
+                }
+            }
+        }
+        if (changed)
+            return false;
+
+        std::vector<long long> reduced;
+        CSRGraph csr = csrOf(edges, reduced, [&](const Edge &e) { return wideSub(wideAdd(e.w, h[e.u]), h[e.v]); });
 
-    int INF = 9999;
+        const long long UNREACHED = std::numeric_limits<long long>::max();
+        std::vector<DefaultQueue<long long>> queues;
+        std::vector<std::vector<long long>> distance(pool.size(), std::vector<long long>(V));
+        std::vector<std::vector<int>> parents(pool.size(), std::vector<int>(V));
+        for (int t = 0; t <= pool.size()-1; ++t) {
+            queues.emplace_back(V);
+        }
+
+        pool.parallelFor(0, V, [&](std::size_t source, int t) {
+            int s = static_cast<int>(source);
+            auto &queue = queues[t];
+            auto &d = distance[t];
+            auto &parent = parents[t];
+            std::fill(std::begin(d), std::end(d), UNREACHED);
+            std::fill(std::begin(parent), std::end(parent), -1);
+
+            queue.clear();
+            d[s] = 0;
+            queue.push(s, 0);
+            while (!queue.empty()) {
+                int u = queue.extract();
+                for (std::size_t arc = csr.begin(u); arc < csr.end(u); ++arc) {
+                    int v = csr.target(arc);
+                    long long dv = wideAdd(d[u], reduced[arc]);
+                    if (dv < d[v]) {
+                        d[v] = dv;
+                        parent[v] = u;
+                        queue.update(v, dv);
+                    }
+                }
+            }
+
+            Weight *row = shortestPathWights.row(s);
+            for (int v = 0; v <= V-1; ++v) {
+                row[v] = d[v] == UNREACHED ? INF : clamp(wideSub(wideAdd(d[v], h[v]), h[s]));
+            }
+            if (predecessors) {
+                std::copy(std::begin(parent), std::end(parent), predecessors->row(s));
+            }
+        }, 1);
+        return true;
+    }
+
+    static Weight clamp(long long d) {
+        if (d >= static_cast<long long>(INF))
+            return INF;
+        return static_cast<Weight>(std::max<long long>(d, std::numeric_limits<Weight>::min()));
+    }
+
+    int V = 0;
+    long long E = 0;
+    bool computed = false;
+    Storage storage;
+    std::unique_ptr<Matrix<Weight>> adjMatrix;
+    CSRGraph arcs;
+    std::vector<Weight> arcWeights;
+    Matrix<Weight> shortestPathWights;
+    std::unique_ptr<Matrix<int>> predecessors;
+    ThreadPool &pool;
 };
 
-int main () {
+//Sparse random graph with about degree arcs per vertex, weights that may be
+//negative but no negative cycle (a positive base plus a potential difference).
+void benchmark(int V, int degree) {
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> any(0, V-1);
+    std::uniform_int_distribution<int> base(1, 20);
+    std::uniform_int_distribution<int> potential(0, 10);
+    std::vector<int> p(V);
+    for (auto &x: p) {
+        x = potential(rng);
+    }
+
+    ThreadPool pool;
+    FloydWarshall floydWarshall(V, pool);
+    FloydWarshall johnson(V, pool);
+    FloydWarshall<std::int16_t> lean(V, pool, {.adjacencyMatrix = false, .predecessors = false});
+    for (int i = 0; i <= V * degree - 1; ++i) {
+        int u = any(rng);
+        int v = any(rng);
+        if (u == v)
+            continue;
+        int w = base(rng) + p[u] - p[v];
+        floydWarshall.addEdge(u, v, w);
+        johnson.addEdge(u, v, w);
+        lean.addEdge(u, v, static_cast<std::int16_t>(w));
+    }
+
+    std::cout << "Random graph V=" << V << " with " << degree << " arcs per vertex:" << std::endl;
+    auto time = [](auto f) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+    double fw = time([&]() { floydWarshall.compute(FloydWarshall<>::METHOD::FLOYD_WARSHALL); });
+    double jo = time([&]() { johnson.compute(); });
+    double le = time([&]() { lean.compute(FloydWarshall<std::int16_t>::METHOD::FLOYD_WARSHALL); });
+
+    bool same = true;
+    bool sameLean = true;
+    for (int u = 0; u <= V-1; ++u) {
+        for (int v = 0; v <= V-1; ++v) {
+            same &= floydWarshall.distance(u, v) == johnson.distance(u, v);
+            sameLean &= floydWarshall.distance(u, v) == (lean.distance(u, v) == lean.INF ? floydWarshall.INF : lean.distance(u, v));
+        }
+    }
+    auto MB = [](std::size_t bytes) { return bytes / (1024.0 * 1024.0); };
+    std::cout << "  floyd-warshall: " << fw * 1000 << " ms, " << MB(floydWarshall.bytes()) << " MB" << std::endl;
+    std::cout << "  johnson: " << jo * 1000 << " ms" << (same ? "" : " (distances differ!)") << std::endl;
+    std::cout << "  floyd-warshall, int16 without adjacency and predecessors: " << le * 1000 << " ms, "
+              << MB(lean.bytes()) << " MB" << (sameLean ? "" : " (distances differ!)") << std::endl;
+
+    //Half the updates lower an arc (or add a missing one), half raise one.
+    const int UPDATES = 100;
+    std::vector<std::array<int, 3>> updates;
+    for (int i = 0; i <= UPDATES-1; ++i) {
+        int u = any(rng);
+        int v = (u + 1 + any(rng) % (V - 1)) % V;
+        int w = base(rng) + p[u] - p[v] + (i % 2 ? 20 : -base(rng) / 2);
+        updates.push_back({u, v, w});
+    }
+    double up = time([&]() {
+        for (auto [u, v, w]: updates) {
+            floydWarshall.updateEdge(u, v, w);
+        }
+    });
+    double re = time([&]() { johnson.compute(FloydWarshall<>::METHOD::FLOYD_WARSHALL); });
+    for (auto [u, v, w]: updates) {
+        johnson.updateEdge(u, v, w);
+    }
+    johnson.compute(FloydWarshall<>::METHOD::FLOYD_WARSHALL);
+
+    bool sameUpdated = true;
+    for (int u = 0; u <= V-1; ++u) {
+        for (int v = 0; v <= V-1; ++v) {
+            sameUpdated &= floydWarshall.distance(u, v) == johnson.distance(u, v);
+        }
+    }
+    std::cout << "  updateEdge: " << up * 1000 / UPDATES << " ms per update, full recompute " << re * 1000 << " ms"
+              << (sameUpdated ? "" : " (distances differ!)") << std::endl;
+}
+
+//Weights scaled so that path lengths leave int32: with int64_t distances
+//they must come out exact, with int distances they must saturate to INF
+//the same way on every method. AUTO picks Johnson on this sparse graph, the
+//lean table keeps its arcs in the CSR. Saturation only agrees without
+//negative arcs (maxPotential 0): otherwise a path can fit although a prefix
+//of it does not, which Johnson's long long sums still find but
+//Floyd-Warshall's saturated prefix hides.
+template <typename Weight>
+void benchmarkWide(int V, int degree, long long scale, int maxPotential) {
+    std::mt19937 rng(2);
+    std::uniform_int_distribution<int> any(0, V-1);
+    std::uniform_int_distribution<int> base(1, 20);
+    std::uniform_int_distribution<int> potential(0, maxPotential);
+    std::vector<long long> p(V);
+    for (auto &x: p) {
+        x = potential(rng) * scale;
+    }
+
+    using METHOD = typename FloydWarshall<Weight>::METHOD;
+    ThreadPool pool;
+    FloydWarshall<Weight> automatic(V, pool);
+    FloydWarshall<Weight> johnson(V, pool);
+    FloydWarshall<Weight> floydWarshall(V, pool);
+    FloydWarshall<Weight> lean(V, pool, {.adjacencyMatrix = false, .predecessors = false});
+    for (int i = 0; i <= V * degree - 1; ++i) {
+        int u = any(rng);
+        int v = any(rng);
+        if (u == v)
+            continue;
+        Weight w = static_cast<Weight>(base(rng) * scale + p[u] - p[v]);
+        automatic.addEdge(u, v, w);
+        johnson.addEdge(u, v, w);
+        floydWarshall.addEdge(u, v, w);
+        lean.addEdge(u, v, w);
+    }
+
+    std::cout << "Random graph V=" << V << ", " << sizeof(Weight) * 8 << "-bit distances, weights scaled by "
+              << scale << ":" << std::endl;
+    auto time = [](auto f) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+    double au = time([&]() { automatic.compute(); });
+    double jo = time([&]() { johnson.compute(METHOD::JOHNSON); });
+    double fw = time([&]() { floydWarshall.compute(METHOD::FLOYD_WARSHALL); });
+    double le = time([&]() { lean.compute(); });
+
+    bool same = true;
+    int saturated = 0;
+    for (int u = 0; u <= V-1; ++u) {
+        for (int v = 0; v <= V-1; ++v) {
+            Weight d = floydWarshall.distance(u, v);
+            same &= automatic.distance(u, v) == d && johnson.distance(u, v) == d && lean.distance(u, v) == d;
+            saturated += d == floydWarshall.INF;
+        }
+    }
+    std::cout << "  auto " << au * 1000 << " ms, johnson " << jo * 1000 << " ms, floyd-warshall " << fw * 1000
+              << " ms, lean " << le * 1000 << " ms, " << saturated << " INF pairs"
+              << (same ? "" : " (distances differ!)") << std::endl;
+}
+
+int main (int argc, char **argv) {
     std::cout << "All pairs shortest paths - Floyd Warshall Algorithm" << std::endl;
-    FloydWarshall allPairsShortestPaths(5);
+    if (argc > 1 && std::string(argv[1]) == "--bench") {
+        benchmark(1000, 4);
+        benchmark(2000, 4);
+        benchmarkWide<std::int64_t>(1000, 4, 1000000000, 10);
+        benchmarkWide<int>(1000, 4, 50000000, 0);
+        return 0;
+    }
+
+    ThreadPool pool;
+    FloydWarshall allPairsShortestPaths(5, pool);
     allPairsShortestPaths.addEdge(0,1,3);
     allPairsShortestPaths.addEdge(0,4,-4);
     allPairsShortestPaths.addEdge(0,2,8);
@@ -92,4 +870,45 @@ int main () {
 
     allPairsShortestPaths.compute();
     allPairsShortestPaths.print();
-}
\ No newline at end of file
+
+    std::cout << "Johnson's algorithm:" << std::endl;
+    allPairsShortestPaths.compute(FloydWarshall<>::METHOD::JOHNSON);
+    allPairsShortestPaths.print();
+
+    std::cout << "After raising 3 -> 2 to 0 and lowering 4 -> 3 to 3:" << std::endl;
+    allPairsShortestPaths.updateEdge(3,2,0);
+    allPairsShortestPaths.updateEdge(4,3,3);
+    allPairsShortestPaths.print();
+
+    std::cout << "Negative self-loops:" << std::endl;
+    try {
+        allPairsShortestPaths.addEdge(2,2,-1);
+    } catch (const std::runtime_error &e) {
+        std::cout << "  addEdge(2, 2, -1): " << e.what() << std::endl;
+    }
+    try {
+        allPairsShortestPaths.updateEdge(2,2,-1);
+    } catch (const std::runtime_error &e) {
+        std::cout << "  updateEdge(2, 2, -1): " << e.what() << std::endl;
+    }
+
+    std::cout << "Without adjacency and predecessor matrices:" << std::endl;
+    FloydWarshall<std::int16_t> lean(5, pool, {.adjacencyMatrix = false, .predecessors = false});
+    lean.addEdge(0,1,3);
+    lean.addEdge(0,4,-4);
+    lean.addEdge(0,2,8);
+    lean.addEdge(1,4,7);
+    lean.addEdge(1,3,1);
+    lean.addEdge(2,1,4);
+    lean.addEdge(3,2,-5);
+    lean.addEdge(3,0,2);
+    lean.addEdge(4,3,6);
+    lean.compute();
+    lean.print();
+
+    std::cout << "Path 1 -> 0:";
+    for (int u: lean.path(1, 0)) {
+        std::cout << " " << u;
+    }
+    std::cout << std::endl;
+}
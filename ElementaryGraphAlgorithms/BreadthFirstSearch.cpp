@@ -0,0 +1,572 @@
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <memory>
+#include <string>
+#include <stdexcept>
+#include <chrono>
+#include <random>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+
+#include "CSRGraph.h"
+#include "GraphLoaders.h"
+#include "ThreadPool.h"
+
+class Graph {
+public:
+    struct Node {
+        int id = 0;
+        std::string name;
+    };
+    using Nodes = std::vector<Node>;
+
+    struct Edge {
+        int u = 0;
+        int v = 0;
+    };
+    using Edges = std::vector<Edge>;
+
+    Graph(int V) : V(V) {
+        nodes.resize(V, Node());
+    }
+
+    void addNode(const std::string &u) {
+        Node n {id, u};
+        nodes[id] = n;
+        nodeMap[u] = id;
+
+        ++id;
+    }
+
+    void addEdge(const std::string& u, const std::string &v) {
+        Edge e{nodeMap[u], nodeMap[v]};
+        edges.emplace_back(e);
+        csrGraph.reset();
+    }
+
+    //Adjacency in CSR form, built in bulk from the edge list on first use.
+    const CSRGraph& csr() const {
+        if (!csrGraph) {
+            csrGraph = std::make_unique<CSRGraph>(V, edges, true);
+        }
+        return *csrGraph;
+    }
+
+    int getV() const { return V; }
+
+    const Node& getNode(const std::string& u) const {
+        auto itr = nodeMap.find(u);
+        if (itr == nodeMap.end()) {
+            throw std::runtime_error("Invalid node");
+        }
+        return nodes[itr->second];
+    }
+
+    const Node& getNode(int u) const {
+        return nodes[u];
+    }
+
+private:
+    int V = 0;
+    int id = 0;
+    Nodes nodes;
+    Edges edges;
+
+    std::unordered_map<std::string, int> nodeMap;
+    mutable std::unique_ptr<CSRGraph> csrGraph;
+};
+
+//One bit per vertex, 64 vertices to a word.
+class Bitmap {
+public:
+    Bitmap(int V = 0) : words((V + 63) / 64, 0) {
+    }
+
+    bool test(int u) const {
+        return words[u >> 6] >> (u & 63) & 1;
+    }
+
+    void set(int u) {
+        words[u >> 6] |= std::uint64_t(1) << (u & 63);
+    }
+
+    void clear() {
+        std::fill(std::begin(words), std::end(words), 0);
+    }
+
+    std::size_t wordCount() const {
+        return words.size();
+    }
+
+    std::uint64_t& word(std::size_t i) {
+        return words[i];
+    }
+
+    std::uint64_t word(std::size_t i) const {
+        return words[i];
+    }
+
+    void swap(Bitmap &other) {
+        words.swap(other.words);
+    }
+
+private:
+    std::vector<std::uint64_t> words;
+};
+
+//Direction-optimizing BFS (Beamer, Asanovic, Patterson). Top-down steps
+//expand a queue of frontier vertices over their out-arcs. Once the frontier's
+//arcs outweigh the arcs left to the unvisited vertices (mf > mu / ALPHA) the
+//search turns bottom-up: every unvisited vertex scans its in-arcs for a
+//parent in the frontier bitmap and stops at the first one. It turns back when
+//the frontier shrinks below V / BETA vertices. Both directions run on the
+//thread pool, bottom-up threads own whole bitmap words so they need no atomics.
+//
+//Bottom-up steps need in-arcs: the graph's reverse CSR when it has one,
+//otherwise its transpose is built once up front.
+class BreadthFirstSearch {
+public:
+    enum class MODE {
+        AUTO = 0,
+        TOP_DOWN = 1,
+        BOTTOM_UP = 2
+    };
+    static const int ALPHA = 14;
+    static const int BETA = 24;
+
+    BreadthFirstSearch(const CSRGraph &csr, ThreadPool &pool) :
+        csr(csr), pool(pool), V(csr.getV()), frontierBits(V), nextBits(V), queues(pool.size()) {
+        if (!csr.hasReverse())
+            transposed = csr.transpose();
+        distance.resize(V, -1);
+        parent.resize(V, -1);
+    }
+
+    void operator() (int source, MODE mode = MODE::AUTO) {
+        std::fill(std::begin(distance), std::end(distance), -1);
+        std::fill(std::begin(parent), std::end(parent), -1);
+        distance[source] = 0;
+        frontier.assign(1, source);
+        bool bitmapFrontier = false;
+        topDownSteps = bottomUpSteps = 0;
+
+        long long unexploredArcs = static_cast<long long>(csr.getE()) - static_cast<long long>(csr.degree(source));
+        long long frontierArcs = static_cast<long long>(csr.degree(source));
+        long long frontierSize = 1;
+        for (int level = 0; frontierSize > 0; ++level) {
+            bool bottomUp = mode == MODE::BOTTOM_UP;
+            if (mode == MODE::AUTO) {
+                bottomUp = bitmapFrontier ? frontierSize >= V / BETA
+                                          : frontierArcs > unexploredArcs / ALPHA;
+            }
+
+            if (bottomUp && !bitmapFrontier) {
+                frontierBits.clear();
+                for (int u: frontier) {
+                    frontierBits.set(u);
+                }
+                bitmapFrontier = true;
+            }
+            else if (!bottomUp && bitmapFrontier) {
+                frontier.clear();
+                for (std::size_t i = 0; i < frontierBits.wordCount(); ++i) {
+                    for (std::uint64_t bits = frontierBits.word(i); bits; bits &= bits - 1) {
+                        frontier.emplace_back(static_cast<int>(i * 64 + std::countr_zero(bits)));
+                    }
+                }
+                bitmapFrontier = false;
+            }
+
+            Counts counts = bottomUp ? bottomUpStep(level) : topDownStep(level);
+            bottomUp ? ++bottomUpSteps : ++topDownSteps;
+            frontierSize = counts.vertices;
+            frontierArcs = counts.arcs;
+            unexploredArcs -= counts.arcs;
+        }
+    }
+
+    void print(const Graph &graph, int source) const {
+        std::cout << "BFS[" << graph.getNode(source).name << "] tree edges:" << std::endl;
+        for (int i = 0; i <= V-1; ++i) {
+            if (parent[i] != -1) {
+                std::cout << graph.getNode(parent[i]).name << "-->" << graph.getNode(i).name << std::endl;
+            }
+        }
+
+        std::cout << "BFS[" << graph.getNode(source).name << "] hop distance:" << std::endl;
+        for (int i = 0; i <= V-1; ++i) {
+            std::cout << graph.getNode(i).name << ":" << distance[i] << std::endl;
+        }
+    }
+
+    //Hops from the last source, -1 when unreachable.
+    int getDistance(int u) const {
+        return distance[u];
+    }
+
+    int getParent(int u) const {
+        return parent[u];
+    }
+
+    int steps(MODE mode) const {
+        return mode == MODE::BOTTOM_UP ? bottomUpSteps : topDownSteps;
+    }
+
+private:
+    //Size of the next frontier in vertices and in out-arcs.
+    struct Counts {
+        long long vertices = 0;
+        long long arcs = 0;
+    };
+
+    //Each pool thread collects the vertices it discovers in its own queue,
+    //claiming them with a CAS on distance.
+    Counts topDownStep(int level) {
+        std::vector<Counts> counts(pool.size());
+        for (auto &queue: queues) {
+            queue.clear();
+        }
+
+        pool.parallelFor(0, frontier.size(), [&](std::size_t i, int t) {
+            int u = frontier[i];
+            for (int v: csr.neighbors(u)) {
+                std::atomic_ref<int> seen(distance[v]);
+                int unvisited = -1;
+                if (seen.load(std::memory_order_relaxed) == -1 &&
+                    seen.compare_exchange_strong(unvisited, level + 1, std::memory_order_relaxed)) {
+                    parent[v] = u;
+                    queues[t].emplace_back(v);
+                    counts[t].arcs += static_cast<long long>(csr.degree(v));
+                }
+            }
+        }, 64);
+
+        frontier.clear();
+        Counts total;
+        for (int t = 0; t <= pool.size()-1; ++t) {
+            frontier.insert(std::end(frontier), std::begin(queues[t]), std::end(queues[t]));
+            total.arcs += counts[t].arcs;
+        }
+        total.vertices = static_cast<long long>(frontier.size());
+        return total;
+    }
+
+    Counts bottomUpStep(int level) {
+        std::vector<Counts> counts(pool.size());
+        pool.parallelFor(0, nextBits.wordCount(), [&](std::size_t i, int t) {
+            std::uint64_t found = 0;
+            int first = static_cast<int>(i * 64);
+            int last = std::min(V, first + 64);
+            for (int v = first; v < last; ++v) {
+                if (distance[v] != -1)
+                    continue;
+
+                for (int u: incoming(v)) {
+                    if (frontierBits.test(u)) {
+                        distance[v] = level + 1;
+                        parent[v] = u;
+                        found |= std::uint64_t(1) << (v - first);
+                        ++counts[t].vertices;
+                        counts[t].arcs += static_cast<long long>(csr.degree(v));
+                        break;
+                    }
+                }
+            }
+            nextBits.word(i) = found;
+        }, 16);
+
+        frontierBits.swap(nextBits);
+        Counts total;
+        for (auto &count: counts) {
+            total.vertices += count.vertices;
+            total.arcs += count.arcs;
+        }
+        return total;
+    }
+
+    std::span<const int> incoming(int v) const {
+        return csr.hasReverse() ? csr.inNeighbors(v) : transposed.neighbors(v);
+    }
+
+    const CSRGraph &csr;
+    CSRGraph transposed;
+    ThreadPool &pool;
+    int V = 0;
+
+    std::vector<int> distance;
+    std::vector<int> parent;
+    std::vector<int> frontier;
+    Bitmap frontierBits;
+    Bitmap nextBits;
+    std::vector<std::vector<int>> queues;
+    int topDownSteps = 0;
+    int bottomUpSteps = 0;
+};
+
+//Multi-source BFS (Then et al., "The More the Merrier"): up to 64 searches
+//share one traversal, vertex v keeps one bit per search in seen[v] and in the
+//current and next frontier masks, so a single scan of an arc advances every
+//search that has its tail in the frontier. Levels with a heavy frontier go
+//bottom-up as in BreadthFirstSearch. Batches of 64 sources run on the pool
+//threads, each with its own masks.
+class MultiSourceBFS {
+public:
+    static const int LANES = 64;
+
+    MultiSourceBFS(const CSRGraph &csr, ThreadPool &pool) :
+        csr(csr), pool(pool), V(csr.getV()), scratch(pool.size()) {
+        if (!csr.hasReverse())
+            transposed = csr.transpose();
+    }
+
+    //Calls visit(i, v, hops) once for every vertex v reachable from
+    //sources[i]. Batches run concurrently, but all calls for one i come from
+    //the same thread, so per-source state needs no locking.
+    template <typename Visitor>
+    void operator() (const std::vector<int> &sources, Visitor visit) {
+        std::size_t batches = (sources.size() + LANES - 1) / LANES;
+        pool.parallelFor(0, batches, [&](std::size_t batch, int t) {
+            std::size_t first = batch * LANES;
+            std::size_t count = std::min<std::size_t>(LANES, sources.size() - first);
+            run(&sources[first], static_cast<int>(count), scratch[t], [&](int lane, int v, int hops) {
+                visit(first + lane, v, hops);
+            });
+        }, 1);
+    }
+
+    //Hop distances from every source, distances[i][v] = -1 when unreachable.
+    std::vector<std::vector<int>> distances(const std::vector<int> &sources) {
+        std::vector<std::vector<int>> result(sources.size(), std::vector<int>(V, -1));
+        (*this)(sources, [&](std::size_t i, int v, int hops) {
+            result[i][v] = hops;
+        });
+        return result;
+    }
+
+private:
+    struct Masks {
+        std::vector<std::uint64_t> seen;
+        std::vector<std::uint64_t> visit;
+        std::vector<std::uint64_t> visitNext;
+    };
+
+    template <typename Visitor>
+    void run(const int *sources, int count, Masks &masks, Visitor visit) {
+        masks.seen.assign(V, 0);
+        masks.visit.assign(V, 0);
+        masks.visitNext.assign(V, 0);
+        for (int lane = 0; lane <= count-1; ++lane) {
+            std::uint64_t bit = std::uint64_t(1) << lane;
+            masks.seen[sources[lane]] |= bit;
+            masks.visit[sources[lane]] |= bit;
+            visit(lane, sources[lane], 0);
+        }
+
+        std::uint64_t all = count == LANES ? ~std::uint64_t(0) : (std::uint64_t(1) << count) - 1;
+        long long frontierArcs = 0;
+        for (int lane = 0; lane <= count-1; ++lane) {
+            frontierArcs += static_cast<long long>(csr.degree(sources[lane]));
+        }
+
+        for (int level = 1; ; ++level) {
+            bool active = false;
+            if (frontierArcs > static_cast<long long>(csr.getE()) / BreadthFirstSearch::ALPHA) {
+                //Bottom-up: a vertex ORs the masks of its in-neighbours and
+                //stops once every search that has not seen it is covered.
+                for (int v = 0; v <= V-1; ++v) {
+                    std::uint64_t missing = all & ~masks.seen[v];
+                    if (!missing)
+                        continue;
+
+                    std::uint64_t reached = 0;
+                    for (int u: incoming(v)) {
+                        reached |= masks.visit[u] & missing;
+                        if (reached == missing)
+                            break;
+                    }
+                    masks.visitNext[v] = reached;
+                    masks.seen[v] |= reached;
+                }
+            }
+            else {
+                for (int u = 0; u <= V-1; ++u) {
+                    std::uint64_t lanes = masks.visit[u];
+                    if (!lanes)
+                        continue;
+
+                    for (int v: csr.neighbors(u)) {
+                        std::uint64_t reached = lanes & ~masks.seen[v];
+                        if (reached) {
+                            masks.visitNext[v] |= reached;
+                            masks.seen[v] |= reached;
+                        }
+                    }
+                }
+            }
+
+            frontierArcs = 0;
+            for (int v = 0; v <= V-1; ++v) {
+                std::uint64_t reached = masks.visitNext[v];
+                for (std::uint64_t bits = reached; bits; bits &= bits - 1) {
+                    visit(std::countr_zero(bits), v, level);
+                }
+                masks.visit[v] = reached;
+                masks.visitNext[v] = 0;
+                if (reached) {
+                    active = true;
+                    frontierArcs += static_cast<long long>(csr.degree(v));
+                }
+            }
+            if (!active)
+                break;
+        }
+    }
+
+    std::span<const int> incoming(int v) const {
+        return csr.hasReverse() ? csr.inNeighbors(v) : transposed.neighbors(v);
+    }
+
+    const CSRGraph &csr;
+    CSRGraph transposed;
+    ThreadPool &pool;
+    int V = 0;
+    std::vector<Masks> scratch;
+};
+
+//Undirected random graph with a few hubs, V vertices and about V * degree
+//arcs: the small diameter and fat middle levels typical of social graphs.
+CSRGraph socialGraph(int V, int degree, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> any(0, V-1);
+    std::uniform_int_distribution<int> hub(0, std::max(0, V / 1000 - 1));
+    std::bernoulli_distribution toHub(0.1);
+
+    std::vector<GraphLoader::Edge> edges;
+    edges.reserve(static_cast<std::size_t>(V) * degree);
+    for (long long i = 0; i < static_cast<long long>(V) * degree / 2; ++i) {
+        int u = any(rng);
+        int v = toHub(rng) ? hub(rng) : any(rng);
+        edges.emplace_back(GraphLoader::Edge{u, v, 1});
+        edges.emplace_back(GraphLoader::Edge{v, u, 1});
+    }
+    return CSRGraph(V, edges);
+}
+
+void benchmark(const std::string &name, const CSRGraph &csr) {
+    using MODE = BreadthFirstSearch::MODE;
+    const int RUNS = 5;
+    ThreadPool pool;
+    BreadthFirstSearch bfs(csr, pool);
+    std::cout << name << ": V=" << csr.getV() << " E=" << csr.getE() << ", " << pool.size() << " threads" << std::endl;
+
+    std::vector<int> reference;
+    for (auto [mode, label] : {std::pair{MODE::TOP_DOWN, "top-down"}, std::pair{MODE::AUTO, "direction-optimizing"}}) {
+        double seconds = 0;
+        bool same = true;
+        for (int run = 0; run <= RUNS-1; ++run) {
+            int source = static_cast<int>((static_cast<long long>(run) * 7919) % csr.getV());
+            auto start = std::chrono::steady_clock::now();
+            bfs(source, mode);
+            seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            if (run == 0) {
+                std::vector<int> hops(csr.getV());
+                for (int u = 0; u <= csr.getV()-1; ++u) {
+                    hops[u] = bfs.getDistance(u);
+                }
+                if (reference.empty())
+                    reference = hops;
+                same = hops == reference;
+            }
+        }
+        std::cout << "  " << label << ": " << seconds / RUNS * 1000 << " ms ("
+                  << bfs.steps(MODE::TOP_DOWN) << " top-down, " << bfs.steps(MODE::BOTTOM_UP) << " bottom-up steps)"
+                  << (same ? "" : " (distances differ!)") << std::endl;
+    }
+
+    const int SOURCES = 512;
+    std::vector<int> sources(SOURCES);
+    for (int i = 0; i <= SOURCES-1; ++i) {
+        sources[i] = static_cast<int>((static_cast<long long>(i) * 104729) % csr.getV());
+    }
+
+    //Sum of hop distances per source, the input to closeness centrality.
+    std::vector<long long> single(SOURCES, 0);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i <= SOURCES-1; ++i) {
+        bfs(sources[i]);
+        for (int u = 0; u <= csr.getV()-1; ++u) {
+            single[i] += std::max(0, bfs.getDistance(u));
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "  " << SOURCES << " sources, one BFS each: " << seconds * 1000 << " ms" << std::endl;
+
+    std::vector<long long> batched(SOURCES, 0);
+    MultiSourceBFS msBfs(csr, pool);
+    start = std::chrono::steady_clock::now();
+    msBfs(sources, [&](std::size_t i, int, int hops) {
+        batched[i] += hops;
+    });
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    bool same = true;
+    for (int i = 0; i <= SOURCES-1; ++i) {
+        same &= batched[i] == single[i];
+    }
+    std::cout << "  " << SOURCES << " sources, multi-source BFS: " << seconds * 1000 << " ms"
+              << (same ? "" : " (distances differ!)") << std::endl;
+}
+
+int main(int argc, char **argv) {
+    std::cout << "Breadth first search" << std::endl;
+    if (argc > 1 && std::string(argv[1]) == "--bench") {
+        benchmark("social-like, 1M nodes, degree 16", socialGraph(1000000, 16, 1));
+        if (argc > 2) {
+            ThreadPool pool;
+            GraphLoader loader(pool);
+            std::string path = argv[2];
+            bool dimacs = path.size() > 3 && path.compare(path.size() - 3, 3, ".gr") == 0;
+            benchmark(path, dimacs ? loader.loadDimacs(path, true) : loader.loadEdgeList(path, true));
+        }
+        return 0;
+    }
+
+    Graph graph(8);
+    for (auto name : {"r", "s", "t", "u", "v", "w", "x", "y"}) {
+        graph.addNode(name);
+    }
+
+    std::vector<std::pair<std::string, std::string>> edges {
+        {"r", "s"}, {"r", "v"}, {"s", "w"}, {"t", "w"}, {"t", "x"}, {"t", "u"},
+        {"u", "x"}, {"u", "y"}, {"w", "x"}, {"x", "y"}
+    };
+    for (auto &[u, v] : edges) {
+        graph.addEdge(u, v);
+        graph.addEdge(v, u);
+    }
+
+    ThreadPool pool(2);
+    BreadthFirstSearch bfs(graph.csr(), pool);
+    int s = graph.getNode("s").id;
+    bfs(s);
+    bfs.print(graph, s);
+
+    bfs(s, BreadthFirstSearch::MODE::BOTTOM_UP);
+    std::cout << "Bottom-up hop distance to y: " << bfs.getDistance(graph.getNode("y").id) << std::endl;
+
+    MultiSourceBFS msBfs(graph.csr(), pool);
+    std::vector<int> sources {graph.getNode("r").id, graph.getNode("t").id};
+    auto distances = msBfs.distances(sources);
+    for (std::size_t i = 0; i < sources.size(); ++i) {
+        std::cout << "Hops from " << graph.getNode(sources[i]).name << ":";
+        for (int v = 0; v <= graph.getV()-1; ++v) {
+            std::cout << " " << graph.getNode(v).name << "=" << distances[i][v];
+        }
+        std::cout << std::endl;
+    }
+
+    return 0;
+}
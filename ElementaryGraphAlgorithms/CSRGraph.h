@@ -0,0 +1,189 @@
+#pragma once
+
+#include <vector>
+#include <span>
+#include <memory>
+#include <cstddef>
+#include <ranges>
+
+//Compressed sparse row graph: the out-arcs of u are
+//targets[offsets[u] .. offsets[u+1]) with matching weights, all arcs of the
+//graph in three flat arrays. Built in bulk from an edge list by a counting
+//sort on the source, which keeps each vertex's arcs in edge-list order.
+//The reverse CSR (in-arcs grouped by target) is optional.
+//
+//The arrays are immutable once built and shared between copies. They are
+//either owned vectors or memory someone else keeps alive through the storage
+//handle, e.g. a memory-mapped binary graph file.
+class CSRGraph {
+public:
+    CSRGraph() = default;
+
+    //Edges is any range of structs with int u, v and optionally int w,
+    //unweighted edge lists leave the weight arrays empty.
+    template <typename Edges>
+    CSRGraph(int V, const Edges &edges, bool withReverse = false) : V(V) {
+        auto arrays = std::make_shared<Arrays>();
+        build(edges, arrays->offsets, arrays->targets, arrays->weights, false);
+        if (withReverse) {
+            build(edges, arrays->inOffsets, arrays->sources, arrays->inWeights, true);
+        }
+        adopt(*arrays);
+        storage = std::move(arrays);
+    }
+
+    //Adopts arrays living in storage without copying them, weights may be
+    //null for an unweighted graph.
+    CSRGraph(int V, const std::size_t *offsets, const int *targets, const int *weights,
+             std::shared_ptr<const void> storage) :
+        V(V), offsets(offsets), targets(targets), weights(weights), storage(std::move(storage)) {
+    }
+
+    int getV() const { return V; }
+
+    std::size_t getE() const { return V ? offsets[V] : 0; }
+
+    bool weighted() const { return weights != nullptr; }
+
+    std::size_t degree(int u) const {
+        return offsets[u+1] - offsets[u];
+    }
+
+    //Arc index range of u, for loops that need the weight alongside the target.
+    std::size_t begin(int u) const { return offsets[u]; }
+    std::size_t end(int u) const { return offsets[u+1]; }
+
+    int target(std::size_t arc) const { return targets[arc]; }
+    int weight(std::size_t arc) const { return weights[arc]; }
+
+    std::span<const int> neighbors(int u) const {
+        return {targets + offsets[u], degree(u)};
+    }
+
+    bool hasReverse() const { return inOffsets != nullptr; }
+
+    std::size_t inDegree(int v) const {
+        return inOffsets[v+1] - inOffsets[v];
+    }
+
+    std::size_t inBegin(int v) const { return inOffsets[v]; }
+    std::size_t inEnd(int v) const { return inOffsets[v+1]; }
+
+    int source(std::size_t arc) const { return sources[arc]; }
+    int inWeight(std::size_t arc) const { return inWeights[arc]; }
+
+    std::span<const int> inNeighbors(int v) const {
+        return {sources + inOffsets[v], inDegree(v)};
+    }
+
+    //Graph with every arc reversed, built from this graph's own arrays so it
+    //also works for graphs that were loaded rather than built from edges.
+    CSRGraph transpose() const {
+        struct Arc {
+            int u = 0;
+            int v = 0;
+            int w = 0;
+        };
+        std::vector<Arc> arcs;
+        arcs.reserve(getE());
+        for (int u = 0; u <= V-1; ++u) {
+            for (std::size_t arc = begin(u); arc < end(u); ++arc) {
+                arcs.emplace_back(Arc{targets[arc], u, weights ? weights[arc] : 0});
+            }
+        }
+        return CSRGraph(V, arcs);
+    }
+
+    //The arcs as a list of Edge{u, v[, w]} in CSR order, for graphs that
+    //adopt a CSR but keep their own edge list. Unweighted arcs get w = 0.
+    template <typename Edge>
+    std::vector<Edge> edgeList() const {
+        std::vector<Edge> edges;
+        edges.reserve(getE());
+        for (int u = 0; u <= V-1; ++u) {
+            for (std::size_t arc = begin(u); arc < end(u); ++arc) {
+                Edge e{};
+                e.u = u;
+                e.v = targets[arc];
+                if constexpr (requires { e.w; }) {
+                    e.w = weights ? weights[arc] : 0;
+                }
+                edges.emplace_back(e);
+            }
+        }
+        return edges;
+    }
+
+    //Whole arrays, for serializing the graph.
+    std::span<const std::size_t> offsetArray() const {
+        return {offsets, V ? static_cast<std::size_t>(V) + 1 : 0};
+    }
+
+    std::span<const int> targetArray() const {
+        return {targets, getE()};
+    }
+
+    std::span<const int> weightArray() const {
+        return {weights, weights ? getE() : 0};
+    }
+
+private:
+    struct Arrays {
+        std::vector<std::size_t> offsets;
+        std::vector<int> targets;
+        std::vector<int> weights;
+
+        std::vector<std::size_t> inOffsets;
+        std::vector<int> sources;
+        std::vector<int> inWeights;
+    };
+
+    void adopt(const Arrays &arrays) {
+        auto data = [](auto &v) { return v.empty() ? nullptr : v.data(); };
+        offsets = data(arrays.offsets);
+        targets = data(arrays.targets);
+        weights = data(arrays.weights);
+        inOffsets = data(arrays.inOffsets);
+        sources = data(arrays.sources);
+        inWeights = data(arrays.inWeights);
+    }
+
+    template <typename Edges>
+    void build(const Edges &edges, std::vector<std::size_t> &offs, std::vector<int> &ends,
+               std::vector<int> &ws, bool reverse) {
+        offs.assign(V + 1, 0);
+        for (const auto &e: edges) {
+            ++offs[(reverse ? e.v : e.u) + 1];
+        }
+        for (int u = 0; u <= V-1; ++u) {
+            offs[u+1] += offs[u];
+        }
+
+        using Edge = std::ranges::range_value_t<Edges>;
+        constexpr bool weighted = requires (const Edge &e) { e.w; };
+
+        std::vector<std::size_t> next(std::begin(offs), std::end(offs) - 1);
+        ends.resize(offs[V]);
+        if constexpr (weighted) {
+            ws.resize(offs[V]);
+        }
+        for (const auto &e: edges) {
+            std::size_t arc = next[reverse ? e.v : e.u]++;
+            ends[arc] = reverse ? e.u : e.v;
+            if constexpr (weighted) {
+                ws[arc] = e.w;
+            }
+        }
+    }
+
+    int V = 0;
+    const std::size_t *offsets = nullptr;
+    const int *targets = nullptr;
+    const int *weights = nullptr;
+
+    const std::size_t *inOffsets = nullptr;
+    const int *sources = nullptr;
+    const int *inWeights = nullptr;
+
+    std::shared_ptr<const void> storage;
+};
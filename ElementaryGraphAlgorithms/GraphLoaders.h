@@ -0,0 +1,279 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <fstream>
+#include <stdexcept>
+#include <charconv>
+#include <atomic>
+#include <ranges>
+#include <cstring>
+#include <cstdint>
+#include <limits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "CSRGraph.h"
+#include "ThreadPool.h"
+
+//Loaders that go straight from a file to a CSRGraph:
+//  SNAP edge list: "u v [w]" per line, '#' comments, unweighted arcs get w = 1.
+//  DIMACS .gr:     "p sp n m" header, "a u v w" arcs with 1-based ids, "c"
+//                  comments; any other line is malformed.
+//  Binary:         header + offsets + targets [+ weights], see saveBinary.
+//Text files are memory-mapped and cut into chunks at line boundaries, every
+//chunk is parsed by a pool thread into its own edge vector and the CSR is
+//built from the chunks in order. Binary files are mapped and adopted by the
+//CSRGraph as they are, nothing is copied.
+class GraphLoader {
+public:
+    struct Edge {
+        int u = 0;
+        int v = 0;
+        int w = 1;
+    };
+
+    GraphLoader(ThreadPool &pool) : pool(pool) {}
+
+    CSRGraph loadEdgeList(const std::string &path, bool withReverse = false) {
+        return loadText(path, FORMAT::SNAP, withReverse);
+    }
+
+    CSRGraph loadDimacs(const std::string &path, bool withReverse = false) {
+        return loadText(path, FORMAT::DIMACS, withReverse);
+    }
+
+    static CSRGraph loadBinary(const std::string &path) {
+        std::shared_ptr<const char> file;
+        std::size_t size = 0;
+        map(path, file, size);
+
+        BinaryHeader header;
+        if (size < sizeof(header))
+            throw std::runtime_error("Truncated graph file " + path);
+
+        std::memcpy(&header, file.get(), sizeof(header));
+        if (std::memcmp(header.magic, MAGIC, sizeof(header.magic)) != 0)
+            throw std::runtime_error("Not a binary graph file " + path);
+
+        //The arrays are adopted as they are and never checked again, so the
+        //header is checked against the file size without overflowing, and
+        //the offsets and targets have to describe a well-formed CSR.
+        if (header.V > static_cast<std::uint64_t>(std::numeric_limits<int>::max()))
+            throw std::runtime_error("Too many vertices in " + path);
+
+        bool weighted = header.flags & WEIGHTED;
+        std::size_t offsetsBytes = (header.V + 1) * sizeof(std::uint64_t);
+        std::size_t arcSize = sizeof(std::int32_t) * (weighted ? 2 : 1);
+        if (size - sizeof(header) < offsetsBytes || header.E > (size - sizeof(header) - offsetsBytes) / arcSize)
+            throw std::runtime_error("Truncated graph file " + path);
+
+        int V = static_cast<int>(header.V);
+        std::size_t arcBytes = header.E * sizeof(std::int32_t);
+        const char *data = file.get() + sizeof(header);
+        auto offsets = reinterpret_cast<const std::size_t*>(data);
+        auto targets = reinterpret_cast<const int*>(data + offsetsBytes);
+        auto weights = weighted ? reinterpret_cast<const int*>(data + offsetsBytes + arcBytes) : nullptr;
+        if (offsets[0] != 0 || offsets[V] != header.E)
+            throw std::runtime_error("Corrupt offsets in graph file " + path);
+        for (int u = 0; u <= V-1; ++u) {
+            if (offsets[u] > offsets[u+1])
+                throw std::runtime_error("Corrupt offsets in graph file " + path);
+        }
+        for (std::size_t arc = 0; arc < header.E; ++arc) {
+            if (targets[arc] < 0 || targets[arc] >= V)
+                throw std::runtime_error("Corrupt targets in graph file " + path);
+        }
+        return CSRGraph(V, offsets, targets, weights, file);
+    }
+
+    static void saveBinary(const CSRGraph &graph, const std::string &path) {
+        std::ofstream out(path, std::ios::binary);
+        if (!out)
+            throw std::runtime_error("Cannot write graph file " + path);
+
+        BinaryHeader header;
+        std::memcpy(header.magic, MAGIC, sizeof(header.magic));
+        header.V = graph.getV();
+        header.E = graph.getE();
+        header.flags = graph.weighted() ? WEIGHTED : 0;
+
+        auto write = [&](auto span) {
+            out.write(reinterpret_cast<const char*>(span.data()), span.size_bytes());
+        };
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        write(graph.offsetArray());
+        write(graph.targetArray());
+        write(graph.weightArray());
+    }
+
+private:
+    enum class FORMAT {
+        SNAP = 0,
+        DIMACS = 1
+    };
+
+    struct BinaryHeader {
+        char magic[8] = {};
+        std::uint64_t V = 0;
+        std::uint64_t E = 0;
+        std::uint64_t flags = 0;
+    };
+    static_assert(sizeof(std::size_t) == sizeof(std::uint64_t), "binary graphs store 64-bit offsets");
+
+    static constexpr char MAGIC[8] = {'C', 'S', 'R', 'G', 'R', 'P', 'H', '1'};
+    static const std::uint64_t WEIGHTED = 1;
+
+    static void map(const std::string &path, std::shared_ptr<const char> &file, std::size_t &size) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("Cannot open graph file " + path);
+
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Cannot stat graph file " + path);
+        }
+
+        size = static_cast<std::size_t>(st.st_size);
+        if (size == 0) {
+            ::close(fd);
+            file = std::shared_ptr<const char>(new char[1](), std::default_delete<char[]>());
+            return;
+        }
+
+        void *addr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (addr == MAP_FAILED)
+            throw std::runtime_error("Cannot map graph file " + path);
+
+        ::madvise(addr, size, MADV_SEQUENTIAL);
+        file = std::shared_ptr<const char>(static_cast<const char*>(addr),
+            [size](const char *p) { ::munmap(const_cast<char*>(p), size); });
+    }
+
+    CSRGraph loadText(const std::string &path, FORMAT format, bool withReverse) {
+        std::shared_ptr<const char> file;
+        std::size_t size = 0;
+        map(path, file, size);
+        const char *text = file.get();
+
+        //Chunk c parses every line that starts in [cuts[c], cuts[c+1]).
+        std::size_t chunks = std::max<std::size_t>(1, std::min<std::size_t>(size / (1 << 20) + 1, pool.size() * 8));
+        std::vector<std::size_t> cuts(chunks + 1, size);
+        for (std::size_t c = 0; c <= chunks-1; ++c) {
+            std::size_t cut = size / chunks * c;
+            while (cut > 0 && cut < size && text[cut-1] != '\n') {
+                ++cut;
+            }
+            cuts[c] = cut;
+        }
+
+        std::vector<std::vector<Edge>> parts(chunks);
+        std::atomic<int> maxId(-1);
+        std::atomic<long long> declaredV(-1);
+        std::atomic<bool> malformed(false);
+
+        pool.parallelFor(0, chunks, [&](std::size_t c) {
+            int localMax = -1;
+            const char *p = text + cuts[c];
+            const char *end = text + cuts[c+1];
+            while (p < end) {
+                const char *eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+                if (!eol)
+                    eol = end;
+
+                Edge e;
+                switch (parseLine(p, eol, format, e, declaredV)) {
+                case LINE::EDGE:
+                    parts[c].emplace_back(e);
+                    localMax = std::max(localMax, std::max(e.u, e.v));
+                    break;
+                case LINE::BAD:
+                    malformed = true;
+                    break;
+                default:
+                    break;
+                }
+                p = eol + 1;
+            }
+
+            int seen = maxId.load();
+            while (localMax > seen && !maxId.compare_exchange_weak(seen, localMax)) {
+            }
+        }, 1);
+
+        if (malformed)
+            throw std::runtime_error("Malformed line in graph file " + path);
+
+        long long V = std::max<long long>(declaredV.load(), maxId.load() + 1);
+        if (V > std::numeric_limits<int>::max())
+            throw std::runtime_error("Too many vertices in graph file " + path);
+
+        return CSRGraph(static_cast<int>(V), parts | std::views::join, withReverse);
+    }
+
+    enum class LINE {
+        SKIP = 0,
+        EDGE = 1,
+        BAD = 2
+    };
+
+    static LINE parseLine(const char *p, const char *end, FORMAT format, Edge &e, std::atomic<long long> &declaredV) {
+        auto skipSpace = [&]() {
+            while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) {
+                ++p;
+            }
+        };
+        auto number = [&](auto &value) {
+            skipSpace();
+            auto result = std::from_chars(p, end, value);
+            if (result.ec != std::errc())
+                return false;
+            p = result.ptr;
+            return true;
+        };
+
+        skipSpace();
+        if (p == end)
+            return LINE::SKIP;
+
+        if (format == FORMAT::SNAP) {
+            if (*p == '#' || *p == '%')
+                return LINE::SKIP;
+            if (!number(e.u) || !number(e.v) || e.u < 0 || e.v < 0)
+                return LINE::BAD;
+            skipSpace();
+            if (p < end && !number(e.w))
+                return LINE::BAD;
+            return LINE::EDGE;
+        }
+
+        char tag = *p++;
+        if (tag == 'a') {
+            if (!number(e.u) || !number(e.v) || !number(e.w) || e.u < 1 || e.v < 1)
+                return LINE::BAD;
+            --e.u;
+            --e.v;
+            return LINE::EDGE;
+        }
+        if (tag == 'p') {
+            skipSpace();
+            while (p < end && *p != ' ' && *p != '\t') {
+                ++p;
+            }
+            long long n = 0;
+            if (!number(n))
+                return LINE::BAD;
+            declaredV = n;
+            return LINE::SKIP;
+        }
+        return tag == 'c' ? LINE::SKIP : LINE::BAD;
+    }
+
+    ThreadPool &pool;
+};
@@ -1,7 +1,16 @@
 #include <iostream>
 #include <vector>
 #include <unordered_map>
+#include <string>
+#include <algorithm>
 #include <memory>
+#include <chrono>
+#include <random>
+#include <stdexcept>
+
+#include "CSRGraph.h"
+#include "ThreadPool.h"
+#include "../AdvancedDataStructures/DisjointSet.h"
 
 //Graph
 struct Node {
@@ -21,7 +30,18 @@ class Graph {
 public:
     Graph(int V) : V(V) {
         nodes.resize(V, Node());
-        adjList.resize(V, Edges());
+    }
+
+    //Takes every arc of a CSR, e.g. one made by GraphLoader, as an
+    //undirected edge and names every vertex by its id.
+    Graph(const CSRGraph &csr) : Graph(csr.getV()) {
+        if (!csr.weighted() && csr.getE() > 0)
+            throw std::runtime_error("A minimum spanning tree needs a weighted graph");
+
+        for (int u = 0; u <= V-1; ++u) {
+            addNode(std::to_string(u));
+        }
+        edges = csr.edgeList<Edge>();
     }
 
     void addNode(const std::string& name) {
@@ -35,28 +55,16 @@ public:
         addEdge(nodeMap[u].id, nodeMap[v].id, w);
     }
 
+    //Every undirected edge is stored once, as given.
     void addEdge(int u, int v, int w) {
-        Edge forward{u, v, w};
-        edges.emplace_back(forward);
-        adjList[u].emplace_back(forward);
-
-        Edge backword{v, u, w};
-        edges.emplace_back(backword);
-        adjList[v].emplace_back(backword);
+        Edge edge{u, v, w};
+        edges.emplace_back(edge);
     }
 
     Edges& getEdges () {
         return edges;
     }
 
-    Edges& getEdges(const std::string &u) {
-        return getEdges(nodeMap[u].id);
-    }
-
-    Edges& getEdges(int u) {
-        return adjList[u];
-    }
-
     Node getNode(const std::string& u) {
         return getNode(nodeMap[u].id);
     }
@@ -81,129 +89,247 @@ private:
     std::unordered_map<std::string, Node> nodeMap;
 
     Edges edges;
-    std::vector<Edges> adjList;
-
 };
 
-//DisjointSet
-
-struct Set {
-    using SharedPtr = std::shared_ptr<Set>;
-    using WeakPtr = std::weak_ptr<Set>;
+//MST_KRUSKAL
+//
+//  FILTER  Filter-Kruskal (Osipov, Sanders, Singler): split the edges
+//          around a pivot weight like quicksort, solve the light side
+//          first, then drop every heavy edge whose endpoints the light side
+//          already connected before recursing into what is left. Edges that
+//          cannot be in the tree are mostly discarded by the filter instead
+//          of being sorted. Ranges of at most SORT_MAX_EDGES are sorted
+//          directly.
+//  SORT    classic Kruskal, sort all edges then scan them.
+//Both stop as soon as the tree has V-1 edges and work on the graph's own
+//edge list, which compute() leaves reordered. Splits and filters of ranges
+//above PARALLEL_MIN_EDGES run on the pool in place: the chunks count the
+//edges sitting on the wrong side of the split point, and the k-th misplaced
+//edge on the left is swapped with the k-th one on the right. The filter uses
+//DisjointSet::root, which does not write, so threads can share the set
+//between unions.
+class MST_KRUSKAL {
+public:
+    enum class METHOD {
+        FILTER = 0,
+        SORT = 1
+    };
+    static const std::size_t SORT_MAX_EDGES = 1 << 12;
+    static const std::size_t PARALLEL_MIN_EDGES = 1 << 16;
 
-    int id = 0;
-    int rank = 0;
-    WeakPtr parentPtr;
-};
+    MST_KRUSKAL(Graph &graph, ThreadPool &pool) : graph(graph), disjointSet(graph.getV()), edges(graph.getEdges()), pool(pool) {
 
-class DisjointSet {
-public:    
-    DisjointSet(Graph &graph) : graph(graph) {
-        sets.resize(graph.getV(), Set::SharedPtr());
     }
 
-    void makeSet(int u) {
-        Set::SharedPtr setPtr = std::make_shared<Set>();
-        setPtr->id = u;
-        setPtr->parentPtr = setPtr;
-        sets[u] = setPtr;
-    }
+    void compute(METHOD method = METHOD::FILTER){
+        disjointSet = DisjointSet(graph.getV());
+        mst.clear();
+        if (graph.getV() <= 1)
+            return;
 
-    Set::SharedPtr findSet(int u) {
-        return findSet(sets[u]);
+        if (method == METHOD::FILTER)
+            filterKruskal(0, edges.size());
+        else
+            kruskal(0, edges.size());
     }
 
-    Set::SharedPtr findSet (Set::SharedPtr setPtr) {
-        if (!setPtr) return setPtr;
-
-        Set::SharedPtr parentPtr = setPtr->parentPtr.lock();
-        if (!parentPtr) return parentPtr;
-
-        if (setPtr->id != parentPtr->id) {
-            setPtr->parentPtr = findSet(setPtr->parentPtr.lock());
+    long long weight() const {
+        long long total = 0;
+        for (auto &e: mst) {
+            total += e.w;
         }
-
-        return setPtr->parentPtr.lock();
+        return total;
     }
 
-    void unionSets(int u, int v) {
-        Set::SharedPtr ptru = findSet(u);
-        if (!ptru) {
-            return;
-        }
-
-        Set::SharedPtr ptrv = findSet(v);
-        if(!ptrv) {
-            return;
+    void print(){
+        std::cout << "MST Edges" << std::endl;
+        for (auto &e: mst) {
+            std::cout << "u: " << graph.getNode(e.u).data << ", v: " << graph.getNode(e.v).data << ", w: " << e.w << std::endl;
         }
 
-        if (ptru->id == ptrv->id) return;
-
-        if (ptru->rank > ptrv->rank) {
-            ptrv->parentPtr = ptru;
-        }
-        else if (ptrv->rank > ptru->rank) {
-            ptru->parentPtr = ptrv;
-        }
-        else {
-            ptru->parentPtr = ptrv;
-            ptrv->rank++;
-        }
+        std::cout << "MST Weight: " << weight() << std::endl;
     }
 
 private:
-    Graph &graph;
-    std::vector<Set::SharedPtr> sets;
-};
-
-//MST_KRUSKAL
-class MST_KRUSKAL {
-public:    
-    MST_KRUSKAL(Graph &graph) : graph(graph), disjointSet(graph) {
-
+    bool complete() const {
+        return static_cast<int>(mst.size()) == graph.getV() - 1;
     }
 
-    void compute(){
-        for (auto &node : graph.getNodes()) {
-            disjointSet.makeSet(node.id);
+    void kruskal(std::size_t from, std::size_t to) {
+        std::sort(std::begin(edges) + from, std::begin(edges) + to, [](auto &a, auto &b) { return a.w < b.w; });
+        for (std::size_t i = from; i < to && !complete(); ++i) {
+            if (disjointSet.unionSets(edges[i].u, edges[i].v)) {
+                mst.emplace_back(edges[i]);
+            }
         }
+    }
 
-        Edges edges = graph.getEdges();
-        std::sort(std::begin(edges), std::end(edges), [](auto &a, auto &b) { return a.w < b.w; });
-
-        for (auto &e: edges) {
-            int u = e.u;
-            int v = e.v;
-  
-            Set::SharedPtr ptru = disjointSet.findSet(u);
-            Set::SharedPtr ptrv = disjointSet.findSet(v);
+    void filterKruskal(std::size_t from, std::size_t to) {
+        if (to - from <= SORT_MAX_EDGES) {
+            kruskal(from, to);
+            return;
+        }
 
-            if (ptru->id != ptrv->id) {
-                mst.emplace_back(e);
-                disjointSet.unionSets(u,v);
+        int pivot = pickPivot(from, to);
+        std::size_t mid = split(from, to, [pivot](const Edge &e) { return e.w <= pivot; });
+        if (mid == to) {
+            //Every edge weighs at most the pivot, which then is the maximum.
+            mid = split(from, to, [pivot](const Edge &e) { return e.w < pivot; });
+            if (mid == from) {
+                kruskal(from, to);
+                return;
             }
         }
+
+        filterKruskal(from, mid);
+        if (complete())
+            return;
+
+        std::size_t end = split(mid, to, [this](const Edge &e) { return disjointSet.root(e.u) != disjointSet.root(e.v); });
+        filterKruskal(mid, end);
     }
 
-    void print(){
-        std::cout << "MST Edges" << std::endl;
-        int mstWeight = 0;
-        for (auto &e: mst) {
-            std::cout << "u: " << graph.getNode(e.u).data << ", v: " << graph.getNode(e.v).data << ", w: " << e.w << std::endl;
-            mstWeight += e.w;
+    //Median weight of three spread out edges.
+    int pickPivot(std::size_t from, std::size_t to) const {
+        int a = edges[from].w;
+        int b = edges[from + (to - from) / 2].w;
+        int c = edges[to - 1].w;
+        return std::max(std::min(a, b), std::min(std::max(a, b), c));
+    }
+
+    //Moves the edges of [from, to) that satisfy keep to the front and
+    //returns the end of them. Small ranges keep their order, large ones are
+    //split in parallel without extra storage and do not.
+    template <typename Keep>
+    std::size_t split(std::size_t from, std::size_t to, Keep keep) {
+        if (to - from < PARALLEL_MIN_EDGES) {
+            return std::stable_partition(std::begin(edges) + from, std::begin(edges) + to, keep) - std::begin(edges);
         }
 
-        std::cout << "MST Weight: " << mstWeight << std::endl;
+        std::size_t chunks = static_cast<std::size_t>(pool.size()) * 4;
+        std::size_t chunk = (to - from + chunks - 1) / chunks;
+        std::vector<std::size_t> kept(chunks + 1, 0);
+        pool.parallelFor(0, chunks, [&](std::size_t c) {
+            std::size_t begin = std::min(to, from + c * chunk);
+            std::size_t end = std::min(to, begin + chunk);
+            kept[c + 1] = std::count_if(std::begin(edges) + begin, std::begin(edges) + end, keep);
+        }, 1);
+        for (std::size_t c = 0; c <= chunks-1; ++c) {
+            kept[c + 1] += kept[c];
+        }
+        std::size_t mid = from + kept[chunks];
+
+        //Rejected edges left of mid and kept edges right of it, counted per
+        //chunk of either side. Both sides hold the same number of them.
+        auto leftWrong = [&](const Edge &e) { return !keep(e); };
+        auto rightWrong = [&](const Edge &e) { return keep(e); };
+        auto misplaced = [&](std::size_t begin, std::size_t end, std::vector<std::size_t> &count, auto wrong) {
+            std::size_t length = (end - begin + chunks - 1) / chunks;
+            pool.parallelFor(0, chunks, [&](std::size_t c) {
+                std::size_t first = std::min(end, begin + c * length);
+                std::size_t last = std::min(end, first + length);
+                count[c + 1] = std::count_if(std::begin(edges) + first, std::begin(edges) + last, wrong);
+            }, 1);
+            for (std::size_t c = 0; c <= chunks-1; ++c) {
+                count[c + 1] += count[c];
+            }
+            return length;
+        };
+        std::vector<std::size_t> leftCount(chunks + 1, 0);
+        std::vector<std::size_t> rightCount(chunks + 1, 0);
+        std::size_t leftLength = misplaced(from, mid, leftCount, leftWrong);
+        std::size_t rightLength = misplaced(mid, to, rightCount, rightWrong);
+        std::size_t swaps = leftCount[chunks];
+        if (swaps == 0)
+            return mid;
+
+        //Position of the k-th edge from begin on for which wrong holds.
+        auto locate = [&](std::size_t begin, std::size_t length, const std::vector<std::size_t> &count, std::size_t k,
+                          auto wrong) {
+            std::size_t c = std::upper_bound(std::begin(count), std::end(count), k) - std::begin(count) - 1;
+            std::size_t i = begin + c * length;
+            for (std::size_t seen = count[c]; ; ++i) {
+                if (wrong(edges[i]) && seen++ == k)
+                    return i;
+            }
+        };
+        //Every chunk swaps its own share of the pairs. All starting points
+        //are found before any swap so no chunk reads another one's edges.
+        std::vector<std::size_t> leftStart(chunks), rightStart(chunks);
+        pool.parallelFor(0, chunks, [&](std::size_t c) {
+            std::size_t first = swaps * c / chunks;
+            if (first == swaps * (c + 1) / chunks)
+                return;
+            leftStart[c] = locate(from, leftLength, leftCount, first, leftWrong);
+            rightStart[c] = locate(mid, rightLength, rightCount, first, rightWrong);
+        }, 1);
+        pool.parallelFor(0, chunks, [&](std::size_t c) {
+            std::size_t i = leftStart[c];
+            std::size_t j = rightStart[c];
+            for (std::size_t k = swaps * c / chunks; k < swaps * (c + 1) / chunks; ++k) {
+                while (!leftWrong(edges[i]))
+                    ++i;
+                while (!rightWrong(edges[j]))
+                    ++j;
+                std::swap(edges[i++], edges[j++]);
+            }
+        }, 1);
+        return mid;
     }
 
-private:
     Graph &graph;
     DisjointSet  disjointSet;
     Edges mst;
-
+    Edges &edges;
+    ThreadPool &pool;
 };
-int main() {
+
+//Random connected graph: a random spanning path plus E more edges.
+void benchmark(int V, long long E) {
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> any(0, V-1);
+    std::uniform_int_distribution<int> weight(1, 1000000);
+    Graph graph(V);
+    for (int i = 0; i <= V-1; ++i) {
+        graph.addNode(std::to_string(i));
+    }
+    std::vector<int> order(V);
+    for (int i = 0; i <= V-1; ++i) {
+        order[i] = i;
+    }
+    std::shuffle(std::begin(order), std::end(order), rng);
+    for (int i = 1; i <= V-1; ++i) {
+        graph.addEdge(order[i-1], order[i], weight(rng));
+    }
+    for (long long i = 0; i <= E-1; ++i) {
+        int u = any(rng);
+        int v = any(rng);
+        if (u != v)
+            graph.addEdge(u, v, weight(rng));
+    }
+
+    ThreadPool pool;
+    auto time = [&](MST_KRUSKAL::METHOD method) {
+        MST_KRUSKAL kruskal(graph, pool);
+        auto start = std::chrono::steady_clock::now();
+        kruskal.compute(method);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return std::make_pair(seconds, kruskal.weight());
+    };
+    auto [filter, filterWeight] = time(MST_KRUSKAL::METHOD::FILTER);
+    auto [sort, sortWeight] = time(MST_KRUSKAL::METHOD::SORT);
+    std::cout << "Random graph V=" << V << " E=" << graph.getEdges().size() << ": filter-kruskal " << filter * 1000
+              << " ms, sort " << sort * 1000 << " ms" << (filterWeight == sortWeight ? "" : " (weights differ!)") << std::endl;
+}
+
+int main(int argc, char **argv) {
     std::cout << "MST-KRUSKAL" << std::endl;
+    if (argc > 1 && std::string(argv[1]) == "--bench") {
+        benchmark(100000, 1000000);
+        benchmark(100000, 10000000);
+        benchmark(1000000, 20000000);
+        return 0;
+    }
     Graph graph(9);
     graph.addNode("a");
     graph.addNode("b");
@@ -230,7 +356,8 @@ int main() {
     graph.addEdge("g", "i", 6);
     graph.addEdge("h", "i", 7);
 
-    MST_KRUSKAL mst(graph);
+    ThreadPool pool;
+    MST_KRUSKAL mst(graph, pool);
     mst.compute();
 
     mst.print();
@@ -5,6 +5,13 @@
 #include <memory>
 #include <limits>
 #include <unordered_set>
+#include <string>
+#include <chrono>
+#include <random>
+#include <stdexcept>
+
+#include "CSRGraph.h"
+#include "PriorityQueues.h"
 
 struct Node {
     int id = 0;
@@ -23,7 +30,22 @@ class Graph {
 public:
     Graph(int V) : V(V) {
         nodes.resize(V, Node());
-        adjList.resize(V, Edges());
+    }
+
+    //Takes the arcs of a CSR, e.g. one made by GraphLoader, as undirected
+    //edges and names every vertex by its id. Each arc is added in both
+    //directions, so a file that lists every edge once gives a symmetric graph.
+    Graph(const CSRGraph &csr) : Graph(csr.getV()) {
+        if (!csr.weighted() && csr.getE() > 0)
+            throw std::runtime_error("A minimum spanning tree needs a weighted graph");
+
+        for (int u = 0; u <= V-1; ++u) {
+            addNode(std::to_string(u));
+        }
+        edges.reserve(2 * csr.getE());
+        for (auto &e: csr.edgeList<Edge>()) {
+            addEdge(e.u, e.v, e.w);
+        }
     }
     void addNode(const std::string &name) {
         Node n {id, name};
@@ -33,19 +55,28 @@ public:
     }
 
     void addEdge(const std::string &u, const std::string &v, int w) {
-        Edge forward {nodeMap[u].id, nodeMap[v].id, w};
-        adjList[nodeMap[u].id].emplace_back(forward);
+        addEdge(nodeMap[u].id, nodeMap[v].id, w);
+    }
 
-        Edge backward {nodeMap[v].id, nodeMap[u].id, w};
-        adjList[nodeMap[v].id].emplace_back(backward);
+    void addEdge(int u, int v, int w) {
+        Edge forward {u, v, w};
+        edges.emplace_back(forward);
+
+        Edge backward {v, u, w};
+        edges.emplace_back(backward);
+        csrGraph.reset();
     }
 
-    Edges& getEdges(const std::string &u) {
-        return getEdges(nodeMap[u].id);
+    Edges& getEdges() {
+        return edges;
     }
 
-    Edges& getEdges(int u) {
-        return adjList[u];
+    //Adjacency in CSR form, built in bulk from the edge list on first use.
+    const CSRGraph& csr() {
+        if (!csrGraph) {
+            csrGraph = std::make_unique<CSRGraph>(V, edges);
+        }
+        return *csrGraph;
     }
 
     Node& getNode(const std::string &u) {
@@ -67,128 +98,189 @@ private:
     Nodes nodes;
     std::unordered_map<std::string, Node> nodeMap;
     Edges edges;
-    std::vector<Edges> adjList;
-
+    std::unique_ptr<CSRGraph> csrGraph;
 };
 
 
-class MinHeap{
+//Prim's algorithm, growing a spanning tree (a forest if the graph is not
+//connected) from vertex 0. Every vertex keeps the lightest arc seen so far
+//from the tree as its key and tree parent.
+//
+//  HEAP   keys in the indexed 4-ary heap, O(E log V).
+//  DENSE  keys in a plain array scanned for the minimum on every step,
+//         O(V^2 + E) with no heap at all, which wins once most pairs of
+//         vertices are adjacent.
+//The weight of each tree edge is recorded when the vertex joins the tree.
+class MST_Prim {
 public:
-    struct Data {
-        using Ptr = std::shared_ptr<Data>;
-        
-        Data(int id, int key) : id(id), key(key) {}
-
-        int id = 0;
-        int key = 0;
-
-
+    //AUTO runs DENSE when arcs / V^2 is at least DENSE_MIN_DENSITY.
+    enum class METHOD {
+        AUTO = 0,
+        HEAP = 1,
+        DENSE = 2
     };
+    static constexpr double DENSE_MIN_DENSITY = 0.5;
 
-    MinHeap() {
-    }
-
-    void insert(int id, int key) {
-        Data::Ptr dataPtr = std::make_shared<Data>(id, key);
-        dataPtrVector.emplace_back(dataPtr);
-        dataPtrMap[id] = dataPtr;
+    MST_Prim(Graph &graph) : graph(graph) {
+        mst.resize(graph.getV(), -1);
     }
 
-    Data::Ptr extract() {
-        auto cmp = [](auto a, auto b) {
-            return a->key > b->key;
-        };
-
-        std::make_heap (std::begin(dataPtrVector), std::end(dataPtrVector), cmp);
-
-        Data::Ptr min = dataPtrVector.front();
-        dataPtrVector.erase(dataPtrVector.begin());
-        return min;
-    }
+    void compute(METHOD method = METHOD::AUTO) {
+        int V = graph.getV();
+        if (method == METHOD::AUTO) {
+            double density = static_cast<double>(graph.csr().getE()) / (static_cast<double>(V) * V);
+            method = density >= DENSE_MIN_DENSITY ? METHOD::DENSE : METHOD::HEAP;
+        }
 
-    void key(int id, int key) {
-        dataPtrMap[id]->key = key;
+        mst.assign(V, -1);
+        weights.assign(V, 0);
+        key.assign(V, std::numeric_limits<int>::max());
+        visited.assign(V, false);
+        if (method == METHOD::DENSE)
+            dense();
+        else
+            heap();
     }
 
-    int key(int id) {
-        return dataPtrMap[id]->key;
+    long long weight() const {
+        long long total = 0;
+        for (int w: weights) {
+            total += w;
+        }
+        return total;
     }
 
-    bool empty() {
-        return dataPtrVector.empty();
+    void print () {
+        std::cout << "MST Edges:" << std::endl;
+        for (int i = 0; i <= graph.getV()-1; ++i) {
+            if (mst[i] != -1) {
+                std::cout << graph.getNode(i).data << "--" << graph.getNode(mst[i]).data << ": " << weights[i] << std::endl;
+            }
+        }
+        std::cout << "MST Weight: " << weight() << std::endl;
     }
-
 private:
-    std::vector<Data::Ptr> dataPtrVector;
-    std::unordered_map<int, Data::Ptr> dataPtrMap;
-};
-
-class MST_Prim {
-public:
-    MST_Prim(Graph &graph) : graph(graph) {
-        mst.resize(graph.getV(), -1);
+    void heap() {
+        int V = graph.getV();
+        MinHeap minHeap(V);
+        for (int s = 0; s <= V-1; ++s) {
+            if (visited[s])
+                continue;
+
+            key[s] = 0;
+            minHeap.push(s, 0);
+            while (!minHeap.empty()) {
+                int u = minHeap.extract();
+                join(u, [&](int v, int w) { minHeap.update(v, w); });
+            }
+        }
     }
 
-    void compute() {
-        int max = std::numeric_limits<int>::max();
-        for (auto &node : graph.getNodes() ) {
-            minHeap.insert(node.id, max);
+    //Keys of the vertices outside the tree stay packed at the front of
+    //restKey (restId and slot map between slots and vertices), so the scan for
+    //the minimum is a tight pass over contiguous ints.
+    void dense() {
+        int V = graph.getV();
+        std::vector<int> restKey(key);
+        std::vector<int> restId(V);
+        std::vector<int> slot(V);
+        for (int v = 0; v <= V-1; ++v) {
+            restId[v] = v;
+            slot[v] = v;
         }
 
-        int s = graph.getNodes()[0].id;
-        minHeap.key(s, 0);
-
-        std::vector<bool> visited(graph.getV(), false); 
-        visited[s] = true;
-
-        while(!minHeap.empty()) {
-            MinHeap::Data::Ptr dataPtr = minHeap.extract();
-            int u = dataPtr->id;
-            visited[u] = true;
-
-            for (auto & edge: graph.getEdges(u)) {
-                int v = edge.v;
-                int w = edge.w;
-                                
-                if (!visited[v]) {
-                    int vKey = minHeap.key(v);
-                    if (w < vKey) {
-                        mst[v] = u;
-                        minHeap.key(v, w);
-                    }
-                }
+        for (int n = V; n >= 1; --n) {
+            int best = 0;
+            for (int i = 1; i <= n-1; ++i) {
+                if (restKey[i] < restKey[best])
+                    best = i;
             }
+
+            int u = restId[best];
+            restKey[best] = restKey[n-1];
+            restId[best] = restId[n-1];
+            slot[restId[best]] = best;
+            join(u, [&](int v, int w) { restKey[slot[v]] = w; });
         }
     }
 
-    void print () {
-        std::cout << "MST Edges:" << std::endl;
-        int mstWeight = 0;
-        
-        for (int i = 0; i <= mst.size()-1; ++i) {
-            if (mst[i] != -1) {
-                int w = 0;
-                for (auto &edge: graph.getEdges(i)) {
-                    if (edge.v == mst[i]) {
-                        w = edge.w;
-                        break;
-                    }
-                }
-                std::cout << graph.getNode(i).data << "--" << graph.getNode(mst[i]).data << ": " << w << std::endl;
-                mstWeight += w;
+    //Adds u to the tree and lowers the keys of its neighbors outside it,
+    //lowered(v, key) lets the caller's queue follow.
+    template <typename F>
+    void join(int u, F lowered) {
+        visited[u] = true;
+        if (mst[u] != -1)
+            weights[u] = key[u];
+
+        const CSRGraph &csr = graph.csr();
+        for (std::size_t arc = csr.begin(u); arc < csr.end(u); ++arc) {
+            int v = csr.target(arc);
+            int w = csr.weight(arc);
+            if (!visited[v] && w < key[v]) {
+                key[v] = w;
+                mst[v] = u;
+                lowered(v, w);
             }
         }
-        std::cout << "MST Weight: " << mstWeight << std::endl;
     }
-private:
+
     Graph &graph;
-    MinHeap minHeap;
     std::vector<int> mst;
-    Edges mstEdges;
+    std::vector<int> weights;
+    std::vector<int> key;
+    std::vector<bool> visited;
 };
 
-int main() {
+//Random connected graph: a random spanning path plus V * degree / 2 more
+//edges, so the heap and dense variants can be compared at any density.
+void benchmark(int V, int degree) {
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> any(0, V-1);
+    std::uniform_int_distribution<int> weight(1, 1000000);
+    Graph graph(V);
+    for (int i = 0; i <= V-1; ++i) {
+        graph.addNode(std::to_string(i));
+    }
+    std::vector<int> order(V);
+    for (int i = 0; i <= V-1; ++i) {
+        order[i] = i;
+    }
+    std::shuffle(std::begin(order), std::end(order), rng);
+    for (int i = 1; i <= V-1; ++i) {
+        graph.addEdge(order[i-1], order[i], weight(rng));
+    }
+    for (long long i = 0; i <= static_cast<long long>(V) * degree / 2 - 1; ++i) {
+        int u = any(rng);
+        int v = any(rng);
+        if (u != v)
+            graph.addEdge(u, v, weight(rng));
+    }
+    graph.csr();
+
+    auto time = [&](MST_Prim::METHOD method) {
+        MST_Prim prim(graph);
+        auto start = std::chrono::steady_clock::now();
+        prim.compute(method);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return std::make_pair(seconds, prim.weight());
+    };
+    auto [heap, heapWeight] = time(MST_Prim::METHOD::HEAP);
+    auto [dense, denseWeight] = time(MST_Prim::METHOD::DENSE);
+    std::cout << "Random graph V=" << V << " with degree " << degree << ": heap " << heap * 1000 << " ms, dense "
+              << dense * 1000 << " ms" << (heapWeight == denseWeight ? "" : " (weights differ!)") << std::endl;
+}
+
+int main(int argc, char **argv) {
     std::cout << "MST Prim's Algorithm" << std::endl;
+    if (argc > 1 && std::string(argv[1]) == "--bench") {
+        benchmark(20000, 4);
+        benchmark(4000, 40);
+        benchmark(4000, 100);
+        benchmark(4000, 200);
+        benchmark(4000, 400);
+        benchmark(4000, 2000);
+        return 0;
+    }
 
     Graph graph(9);
     graph.addNode("a");
@@ -0,0 +1,335 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+#include <cstdint>
+#include <bit>
+#include <limits>
+
+//Addressable min-priority queues over item ids [0, V) for Dijkstra-like
+//searches. They share one interface: push, decreaseKey, update (push or
+//decrease), contains, empty, clear (ready for the next search) and extract
+//(returns the id of a min-key item).
+//
+//  IndexedHeap<D, Key>  D-ary heap, any ordered key type, O(log V) per
+//                       operation.
+//  RadixHeap<Key>       monotone non-negative integer keys: extracted keys
+//                       never decrease and every key is >= the last
+//                       extracted one.
+//  BucketQueue          Dial's buckets, monotone int keys that are at most
+//                       maxWeight above the last extracted key.
+
+//pos[item] is the item's slot in the heap (-1 when absent), which gives
+//O(log V) decreaseKey without searching. With D = 4 the tree is half as deep
+//as a binary heap and the children of a node share one cache line.
+template <int D, typename Key = int>
+class IndexedHeap {
+    struct Entry {
+        Key key = 0;
+        int id = 0;
+    };
+public:
+    IndexedHeap(int V) : pos(V, -1) {
+    }
+
+    bool empty() const {
+        return items.empty();
+    }
+
+    std::size_t size() const {
+        return items.size();
+    }
+
+    bool contains(int item) const {
+        return pos[item] != -1;
+    }
+
+    Key key(int item) const {
+        return items[pos[item]].key;
+    }
+
+    Key topKey() const {
+        return items.front().key;
+    }
+
+    //Empties the heap in O(size), so a heap can be reused across searches
+    //without touching all V positions.
+    void clear() {
+        for (auto &entry: items) {
+            pos[entry.id] = -1;
+        }
+        items.clear();
+    }
+
+    void push(int item, Key key) {
+        items.emplace_back(Entry{key, item});
+        pos[item] = static_cast<int>(items.size()) - 1;
+        siftUp(pos[item]);
+    }
+
+    void decreaseKey(int item, Key key) {
+        items[pos[item]].key = key;
+        siftUp(pos[item]);
+    }
+
+    //Inserts item or lowers its key, whichever applies.
+    void update(int item, Key key) {
+        if (contains(item))
+            decreaseKey(item, key);
+        else
+            push(item, key);
+    }
+
+    int extract() {
+        int min = items.front().id;
+        pos[min] = -1;
+
+        Entry last = items.back();
+        items.pop_back();
+        if (!items.empty()) {
+            items[0] = last;
+            pos[last.id] = 0;
+            siftDown(0);
+        }
+        return min;
+    }
+
+private:
+    void siftUp(int i) {
+        Entry entry = items[i];
+        while (i > 0) {
+            int p = (i - 1) / D;
+            if (items[p].key <= entry.key)
+                break;
+
+            place(i, items[p]);
+            i = p;
+        }
+        place(i, entry);
+    }
+
+    void siftDown(int i) {
+        Entry entry = items[i];
+        int n = static_cast<int>(items.size());
+        while (true) {
+            int first = D * i + 1;
+            if (first >= n)
+                break;
+
+            int best = first;
+            int last = std::min(first + D, n);
+            for (int c = first + 1; c < last; ++c) {
+                if (items[c].key < items[best].key)
+                    best = c;
+            }
+            if (entry.key <= items[best].key)
+                break;
+
+            place(i, items[best]);
+            i = best;
+        }
+        place(i, entry);
+    }
+
+    void place(int i, const Entry &entry) {
+        items[i] = entry;
+        pos[entry.id] = i;
+    }
+
+    std::vector<Entry> items;
+    std::vector<int> pos;
+};
+
+using MinHeap = IndexedHeap<4>;
+using BinaryHeap = IndexedHeap<2>;
+
+//Items sit in unordered buckets, each item remembers its bucket and slot so
+//it can be unlinked in O(1) by swapping with the bucket's last item.
+template <typename Key>
+class Buckets {
+public:
+    Buckets(int V, int count) : keys(V, 0), bucketOf(V, -1), slot(V, 0), buckets(count) {
+    }
+
+    bool contains(int item) const {
+        return bucketOf[item] != -1;
+    }
+
+    Key key(int item) const {
+        return keys[item];
+    }
+
+protected:
+    void link(int item, int b) {
+        bucketOf[item] = b;
+        slot[item] = static_cast<int>(buckets[b].size());
+        buckets[b].emplace_back(item);
+        ++size;
+    }
+
+    void unlink(int item) {
+        auto &bucket = buckets[bucketOf[item]];
+        int moved = bucket.back();
+        bucket[slot[item]] = moved;
+        slot[moved] = slot[item];
+        bucket.pop_back();
+        bucketOf[item] = -1;
+        --size;
+    }
+
+    //Unlinks whatever is still queued, O(size + buckets).
+    void unlinkAll() {
+        for (auto &bucket: buckets) {
+            for (int item: bucket) {
+                bucketOf[item] = -1;
+            }
+            bucket.clear();
+        }
+        size = 0;
+    }
+
+    std::vector<Key> keys;
+    std::vector<int> bucketOf;
+    std::vector<int> slot;
+    std::vector<std::vector<int>> buckets;
+    std::size_t size = 0;
+};
+
+//One-level radix heap (Ahuja, Mehlhorn, Orlin, Tarjan). Bucket 0 holds keys
+//equal to the last extracted key, bucket i > 0 keys whose highest bit that
+//differs from it is bit i-1. When bucket 0 runs dry the first non-empty
+//bucket is redistributed around its minimum, and every item moves to a lower
+//bucket each time, so an item is moved at most BITS times in total.
+template <typename Key = int>
+class RadixHeap : public Buckets<Key> {
+    using Bits = std::make_unsigned_t<Key>;
+    static constexpr int BITS = std::numeric_limits<Bits>::digits;
+    using Buckets<Key>::keys;
+    using Buckets<Key>::buckets;
+    using Buckets<Key>::size;
+    using Buckets<Key>::link;
+    using Buckets<Key>::unlink;
+public:
+    using Buckets<Key>::contains;
+
+    RadixHeap(int V) : Buckets<Key>(V, BITS + 1) {
+    }
+
+    bool empty() const {
+        return size == 0;
+    }
+
+    //Also forgets the last extracted key, so the next search may start
+    //below it.
+    void clear() {
+        this->unlinkAll();
+        last = 0;
+    }
+
+    void push(int item, Key key) {
+        keys[item] = key;
+        link(item, bucket(key));
+    }
+
+    void decreaseKey(int item, Key key) {
+        unlink(item);
+        push(item, key);
+    }
+
+    void update(int item, Key key) {
+        if (contains(item))
+            decreaseKey(item, key);
+        else
+            push(item, key);
+    }
+
+    int extract() {
+        if (buckets[0].empty()) {
+            int b = 1;
+            while (buckets[b].empty()) {
+                ++b;
+            }
+
+            std::vector<int> &moving = scratch;
+            moving.clear();
+            moving.swap(buckets[b]);
+            size -= moving.size();
+            last = static_cast<Bits>(keys[moving[0]]);
+            for (int item: moving) {
+                last = std::min(last, static_cast<Bits>(keys[item]));
+            }
+            for (int item: moving) {
+                link(item, bucket(keys[item]));
+            }
+        }
+
+        int item = buckets[0].back();
+        unlink(item);
+        return item;
+    }
+
+private:
+    int bucket(Key key) const {
+        Bits k = static_cast<Bits>(key);
+        return k == last ? 0 : BITS - std::countl_zero(static_cast<Bits>(k ^ last));
+    }
+
+    Bits last = 0;
+    std::vector<int> scratch;
+};
+
+//Dial's algorithm: maxWeight + 1 buckets used as a ring indexed by key. All
+//queued keys lie in [current, current + maxWeight], so they map to distinct
+//ring slots per key and extract just walks the ring forward.
+class BucketQueue : public Buckets<int> {
+public:
+    BucketQueue(int V, int maxWeight) : Buckets(V, maxWeight + 1) {
+    }
+
+    bool empty() const {
+        return size == 0;
+    }
+
+    //Also rewinds the ring, so the next search may start at any key.
+    void clear() {
+        unlinkAll();
+        current = 0;
+    }
+
+    void push(int item, int key) {
+        keys[item] = key;
+        link(item, key % static_cast<int>(buckets.size()));
+    }
+
+    void decreaseKey(int item, int key) {
+        unlink(item);
+        push(item, key);
+    }
+
+    void update(int item, int key) {
+        if (contains(item))
+            decreaseKey(item, key);
+        else
+            push(item, key);
+    }
+
+    int extract() {
+        while (buckets[current].empty()) {
+            current = (current + 1) % buckets.size();
+        }
+
+        int item = buckets[current].back();
+        unlink(item);
+        return item;
+    }
+
+private:
+    std::size_t current = 0;
+};
+
+//Queue picked at compile time from the key type: monotone integer keys get
+//the radix heap, anything else (floating point distances) a 4-ary heap,
+//both keyed by Key itself.
+template <typename Key>
+using DefaultQueue = std::conditional_t<std::is_integral_v<Key>, RadixHeap<Key>, IndexedHeap<4, Key>>;
@@ -3,6 +3,17 @@
 #include <memory>
 #include <unordered_map>
 #include <limits>
+#include <string>
+#include <stdexcept>
+#include <deque>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <atomic>
+#include <cstdint>
+
+#include "CSRGraph.h"
+#include "ThreadPool.h"
 
 struct Node {
     int id = 0;
@@ -21,8 +32,21 @@ class Graph {
 public:
     Graph(int V) : V(V) {
         nodes.resize(V, Node());
-        adjList.resize(V, Edges());
-        
+    }
+
+    //Adopts a CSR, e.g. one made by GraphLoader, and names every vertex by
+    //its id. The edge list is only rebuilt from the CSR if it is asked for
+    //or extended.
+    Graph(CSRGraph csr) : V(csr.getV()), id(csr.getV()), adopted(true) {
+        if (!csr.weighted() && csr.getE() > 0)
+            throw std::runtime_error("Shortest paths need a weighted graph");
+
+        nodes.resize(V, Node());
+        for (int u = 0; u <= V-1; ++u) {
+            nodes[u] = Node{u, std::to_string(u)};
+            nodeMap[nodes[u].data] = u;
+        }
+        csrGraph = std::make_unique<CSRGraph>(std::move(csr));
     }
 
     void addNode(const std::string &name) {
@@ -34,24 +58,22 @@ public:
 
     void addEdge(const std::string &u, const std::string &v, int w) {
         Edge e {nodeMap[u], nodeMap[v], w};
-        adjList[nodeMap[u]].emplace_back(e);
+        materialize();
         edges.emplace_back(e);
+        csrGraph.reset();
     }
 
     const Edges& getEdges() const {
+        materialize();
         return edges;
     }
 
-    const Edges& getEdges(const std::string &u) const {
-        auto itr = nodeMap.find(u);
-        if (itr == nodeMap.end())
-            throw std::runtime_error("Invalid node " + u);
-        
-        return adjList[itr->second];
-    }
-
-    const Edges& getEdges(int u) const {
-        return adjList[u];
+    //Adjacency in CSR form, built in bulk from the edge list on first use.
+    const CSRGraph& csr() const {
+        if (!csrGraph) {
+            csrGraph = std::make_unique<CSRGraph>(V, edges);
+        }
+        return *csrGraph;
     }
 
     const Node& getNode(const std::string &u) const {
@@ -69,38 +91,92 @@ public:
     int getV() const { return V; }
 
 private:
+    void materialize() const {
+        if (adopted) {
+            edges = csrGraph->edgeList<Edge>();
+            adopted = false;
+        }
+    }
+
     int V = 0;
     int id = 0;
     Nodes nodes;
     std::unordered_map<std::string, int> nodeMap;
 
-    Edges edges;
-    std::vector<Edges> adjList;
+    mutable Edges edges;
+    mutable std::unique_ptr<CSRGraph> csrGraph;
+    mutable bool adopted = false;
 };
 
 
 class BellmanFord {
 public:
+    //PASSES relaxes every arc once per pass, at most V-1 passes, and stops
+    //after a pass that changes nothing. WORKLIST only scans vertices whose
+    //distance changed since their last scan, in FIFO order. The parallel
+    //method is compute(ThreadPool&).
+    //
+    //Every method ends with the same parent tree, see canonicalParents, so
+    //their distance and parent vectors are identical.
+    enum class METHOD {
+        PASSES = 0,
+        WORKLIST = 1
+    };
+
     BellmanFord(const Graph &graph, const std::string &s): graph(graph), s(s) {}
 
-    bool compute() {
+    //Returns false when a negative cycle is reachable from s, negativeCycle()
+    //then holds it.
+    bool compute(METHOD method = METHOD::PASSES) {
         initialize();
+        bool shortestPaths = method == METHOD::WORKLIST ? worklist() : passes();
+        if (shortestPaths)
+            canonicalParents(nullptr);
+        return shortestPaths;
+    }
 
-        for (int i = 1; i <= graph.getV()-1; ++i) {
-            for (const auto &e: graph.getEdges()) {
-                relax(e);
-            }
-        }
+    //Edge-centric Bellman-Ford on the pool: each round splits the edge list
+    //across the threads, which relax into the shared distances with an atomic
+    //min and raise a common flag on any change. Rounds stop once nothing
+    //changed, a change in round V means a negative cycle.
+    bool compute(ThreadPool &pool) {
+        initialize();
+        bool shortestPaths = parallel(pool);
+        if (shortestPaths)
+            canonicalParents(&pool);
+        return shortestPaths;
+    }
 
-        for (const auto &e: graph.getEdges()) {
-            if (distance[e.v] > distance[e.u] + e.w)
-                return false;
-        }
+    //Vertices of the negative cycle found by the last compute(), each one
+    //followed by its successor on the cycle and the last one by the first.
+    const std::vector<int>& negativeCycle() const {
+        return cycle;
+    }
 
-        return true;
+    //Vertex scans (relaxing all out-arcs of one vertex) done by the last
+    //compute(), V per pass for PASSES.
+    long long vertexScans() const {
+        return scans;
+    }
+
+    int getDistance(int u) const {
+        return distance[u];
+    }
+
+    int getParent(int u) const {
+        return parent[u];
     }
 
     void print() {
+        if (!cycle.empty()) {
+            std::cout << "Negative cycle: ";
+            for (int u: cycle) {
+                std::cout << graph.getNode(u).data << "-->";
+            }
+            std::cout << graph.getNode(cycle.front()).data << std::endl;
+            return;
+        }
+
         std::cout << "Single source[" << s << "] shortest paths edges:" << std::endl;
         for (int i = 0; i <= graph.getV()-1; ++i) {
             if (parent[i] != -1) {
@@ -116,31 +192,362 @@ public:
 
 private:
     void initialize() {
-        distance.resize(graph.getV(), MAX);
-        parent.resize(graph.getV(), -1);
+        distance.assign(graph.getV(), MAX);
+        parent.assign(graph.getV(), -1);
+        cycle.clear();
+        scans = 0;
 
         distance[graph.getNode(s).id] = 0;
     }
 
-    void relax(const Edge& e) {
-        if (distance[e.u] == MAX)
-            return;
+    bool passes() {
+        const CSRGraph &csr = graph.csr();
+        bool changed = true;
+        for (int i = 1; i <= graph.getV()-1 && changed; ++i) {
+            changed = false;
+            for (int u = 0; u <= graph.getV()-1; ++u) {
+                ++scans;
+                for (std::size_t arc = csr.begin(u); arc < csr.end(u); ++arc) {
+                    changed |= relax(u, csr.target(arc), csr.weight(arc));
+                }
+            }
+        }
+        if (!changed)
+            return true;
+
+        for (int u = 0; u <= graph.getV()-1; ++u) {
+            if (distance[u] == MAX)
+                continue;
+
+            for (std::size_t arc = csr.begin(u); arc < csr.end(u); ++arc) {
+                int v = csr.target(arc);
+                if (distance[v] > distance[u] + csr.weight(arc)) {
+                    parent[v] = u;
+                    cycleFromParents(v);
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    //Following parents V times from a vertex whose distance still drops
+    //lands on the cycle, which is then read off the parent pointers.
+    void cycleFromParents(int v) {
+        for (int i = 1; i <= graph.getV(); ++i) {
+            v = parent[v];
+            if (v == -1)
+                return;
+        }
+        for (int u = v; ; ) {
+            cycle.emplace_back(u);
+            u = parent[u];
+            if (u == v)
+                break;
+        }
+        std::reverse(std::begin(cycle), std::end(cycle));
+    }
+
+    //Queue-based Bellman-Ford with Tarjan's subtree disassembly. The
+    //shortest path tree is kept as a preorder thread (next/prev with depths),
+    //so the subtree of v is v followed by the run of deeper vertices. When v
+    //improves, its old subtree is cut out of the tree: those distances are
+    //stale and will improve again through v, so scanning them now is wasted
+    //and they are skipped when dequeued. Finding the improving vertex u
+    //inside v's subtree means u's path runs through v, a negative cycle.
+    bool worklist() {
+        const CSRGraph &csr = graph.csr();
+        int V = graph.getV();
+        int source = graph.getNode(s).id;
+
+        std::vector<int> next(V, -1);
+        std::vector<int> prev(V, -1);
+        std::vector<int> depth(V, -1);
+        std::vector<char> queued(V, 0);
+        std::deque<int> queue;
+
+        next[source] = prev[source] = source;
+        depth[source] = 0;
+        queue.emplace_back(source);
+        queued[source] = 1;
+
+        while (!queue.empty()) {
+            int u = queue.front();
+            queue.pop_front();
+            queued[u] = 0;
+            if (depth[u] == -1)
+                continue;
+
+            ++scans;
+            for (std::size_t arc = csr.begin(u); arc < csr.end(u); ++arc) {
+                int v = csr.target(arc);
+                int w = csr.weight(arc);
+                if (distance[v] != MAX && distance[v] <= distance[u] + w)
+                    continue;
+
+                if (depth[v] != -1) {
+                    if (v == u) {
+                        negativeCycle(u, v);
+                        return false;
+                    }
+
+                    //Cut v and its subtree out of the thread.
+                    int after = next[v];
+                    while (depth[after] > depth[v]) {
+                        if (after == u) {
+                            negativeCycle(u, v);
+                            return false;
+                        }
+                        depth[after] = -1;
+                        after = next[after];
+                    }
+                    next[prev[v]] = after;
+                    prev[after] = prev[v];
+                }
+
+                distance[v] = distance[u] + w;
+                parent[v] = u;
+
+                //Hang v under u, right after u in preorder.
+                depth[v] = depth[u] + 1;
+                prev[v] = u;
+                next[v] = next[u];
+                prev[next[u]] = v;
+                next[u] = v;
+
+                if (!queued[v]) {
+                    queue.emplace_back(v);
+                    queued[v] = 1;
+                }
+            }
+        }
+        return true;
+    }
+
+    //A vertex's distance and parent share one 64-bit word, so the pair is
+    //read and replaced atomically and the parent pointers always describe
+    //paths of the stored lengths, which keeps cycleFromParents valid.
+    static std::uint64_t pack(int d, int p) {
+        return static_cast<std::uint64_t>(static_cast<std::uint32_t>(d)) << 32 | static_cast<std::uint32_t>(p);
+    }
+
+    static int distanceOf(std::uint64_t packed) {
+        return static_cast<int>(static_cast<std::uint32_t>(packed >> 32));
+    }
+
+    static int parentOf(std::uint64_t packed) {
+        return static_cast<int>(static_cast<std::uint32_t>(packed));
+    }
+
+    bool parallel(ThreadPool &pool) {
+        const Edges &edges = graph.getEdges();
+        int V = graph.getV();
+        std::vector<std::uint64_t> packed(V, pack(MAX, -1));
+        packed[graph.getNode(s).id] = pack(0, -1);
+
+        std::atomic<bool> changed(true);
+        std::atomic<int> lastChanged(-1);
+        int round = 0;
+        while (changed.load() && round <= V-1) {
+            ++round;
+            changed.store(false);
+            scans += V;
+            pool.parallelFor(0, edges.size(), [&](std::size_t i) {
+                const Edge &e = edges[i];
+                int du = distanceOf(std::atomic_ref<std::uint64_t>(packed[e.u]).load(std::memory_order_relaxed));
+                if (du == MAX)
+                    return;
+
+                int dv = du + e.w;
+                std::atomic_ref<std::uint64_t> target(packed[e.v]);
+                std::uint64_t current = target.load(std::memory_order_relaxed);
+                while (distanceOf(current) > dv) {
+                    if (target.compare_exchange_weak(current, pack(dv, e.u), std::memory_order_relaxed)) {
+                        if (!changed.load(std::memory_order_relaxed))
+                            changed.store(true, std::memory_order_relaxed);
+                        lastChanged.store(e.v, std::memory_order_relaxed);
+                        break;
+                    }
+                }
+            }, 4096);
+        }
+
+        for (int u = 0; u <= V-1; ++u) {
+            distance[u] = distanceOf(packed[u]);
+            parent[u] = parentOf(packed[u]);
+        }
+        if (changed.load()) {
+            cycleFromParents(lastChanged.load());
+            return false;
+        }
+        return true;
+    }
+
+    //Among all shortest path trees picks the one where every vertex is
+    //reached in the fewest arcs and, among its predecessors at that depth on
+    //a shortest path, hangs under the one with the smallest id. This depends
+    //only on the distances, not on the order the relaxations ran in. It is a
+    //BFS over the tight arcs (distance[u] + w == distance[v]), one level at a
+    //time, and runs on the pool when one is given.
+    void canonicalParents(ThreadPool *pool) {
+        const CSRGraph &csr = graph.csr();
+        int V = graph.getV();
+        int source = graph.getNode(s).id;
+
+        std::vector<int> level(V, -1);
+        parent.assign(V, V);
+        level[source] = 0;
+        std::vector<int> frontier {source};
+        std::vector<std::vector<int>> queues(pool ? pool->size() : 1);
+
+        for (int depth = 0; !frontier.empty(); ++depth) {
+            for (auto &queue: queues) {
+                queue.clear();
+            }
+
+            auto visit = [&](std::size_t i, int t) {
+                int u = frontier[i];
+                for (std::size_t arc = csr.begin(u); arc < csr.end(u); ++arc) {
+                    int v = csr.target(arc);
+                    if (distance[v] == MAX || distance[u] + csr.weight(arc) != distance[v])
+                        continue;
+
+                    int seen = -1;
+                    if (std::atomic_ref<int>(level[v]).compare_exchange_strong(seen, depth + 1, std::memory_order_relaxed))
+                        queues[t].emplace_back(v);
+                    else if (seen != depth + 1)
+                        continue;
+
+                    std::atomic_ref<int> p(parent[v]);
+                    int current = p.load(std::memory_order_relaxed);
+                    while (u < current && !p.compare_exchange_weak(current, u, std::memory_order_relaxed)) {
+                    }
+                }
+            };
+            if (pool) {
+                pool->parallelFor(0, frontier.size(), visit, 64);
+            }
+            else {
+                for (std::size_t i = 0; i < frontier.size(); ++i) {
+                    visit(i, 0);
+                }
+            }
+
+            frontier.clear();
+            for (auto &queue: queues) {
+                frontier.insert(std::end(frontier), std::begin(queue), std::end(queue));
+            }
+        }
 
-        if (distance[e.v] == MAX || distance[e.v] > distance[e.u] + e.w ) {
-            distance[e.v] = distance[e.u] +  e.w;
-            parent[e.v] = e.u;
+        for (auto &p: parent) {
+            if (p == V)
+                p = -1;
         }
     }
 
-    const std::string &s;
+    //Cycle closed by the arc u -> v where u descends from v in the tree.
+    void negativeCycle(int u, int v) {
+        for (int x = u; x != v; x = parent[x]) {
+            cycle.emplace_back(x);
+        }
+        cycle.emplace_back(v);
+        std::reverse(std::begin(cycle), std::end(cycle));
+    }
+
+    bool relax(int u, int v, int w) {
+        if (distance[u] == MAX)
+            return false;
+
+        if (distance[v] == MAX || distance[v] > distance[u] + w) {
+            distance[v] = distance[u] + w;
+            parent[v] = u;
+            return true;
+        }
+        return false;
+    }
+
     const Graph &graph;
+    std::string s;
     std::vector<int> distance;
     std::vector<int> parent;
+    std::vector<int> cycle;
+    long long scans = 0;
     int MAX = std::numeric_limits<int>::max();;
 };
 
-int main() {
+//Random graph with negative arcs but no negative cycle: every weight is a
+//positive base plus a potential difference p[u] - p[v], which cancels out
+//around any cycle.
+void benchmark(int V, int E) {
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> any(0, V-1);
+    std::uniform_int_distribution<int> base(1, 100);
+    std::uniform_int_distribution<int> potential(0, 40);
+
+    Graph graph(V);
+    std::vector<int> p(V);
+    for (int u = 0; u <= V-1; ++u) {
+        graph.addNode(std::to_string(u));
+        p[u] = potential(rng);
+    }
+    for (int i = 0; i <= E-1; ++i) {
+        int u = any(rng);
+        int v = any(rng);
+        graph.addEdge(std::to_string(u), std::to_string(v), base(rng) + p[u] - p[v]);
+    }
+
+    std::cout << "Random graph V=" << V << " E=" << E << " with negative arcs:" << std::endl;
+    std::vector<int> reference;
+    std::vector<int> referenceParents;
+    auto parents = [&](const BellmanFord &bellmanFord) {
+        std::vector<int> parent(V);
+        for (int u = 0; u <= V-1; ++u) {
+            parent[u] = bellmanFord.getParent(u);
+        }
+        return parent;
+    };
+    for (auto [method, label] : {std::pair{BellmanFord::METHOD::PASSES, "passes"},
+                                 std::pair{BellmanFord::METHOD::WORKLIST, "worklist"}}) {
+        BellmanFord bellmanFord(graph, "0");
+        auto start = std::chrono::steady_clock::now();
+        bellmanFord.compute(method);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::vector<int> distance(V);
+        for (int u = 0; u <= V-1; ++u) {
+            distance[u] = bellmanFord.getDistance(u);
+        }
+        if (reference.empty()) {
+            reference = distance;
+            referenceParents = parents(bellmanFord);
+        }
+        std::cout << "  " << label << ": " << seconds * 1000 << " ms, "
+                  << static_cast<double>(bellmanFord.vertexScans()) / V << " scans per vertex"
+                  << (distance == reference && parents(bellmanFord) == referenceParents ? "" : " (results differ!)")
+                  << std::endl;
+    }
+
+    ThreadPool pool;
+    BellmanFord bellmanFord(graph, "0");
+    auto start = std::chrono::steady_clock::now();
+    bellmanFord.compute(pool);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    bool same = parents(bellmanFord) == referenceParents;
+    for (int u = 0; u <= V-1; ++u) {
+        same &= bellmanFord.getDistance(u) == reference[u];
+    }
+    std::cout << "  parallel (" << pool.size() << " threads): " << seconds * 1000 << " ms, "
+              << static_cast<double>(bellmanFord.vertexScans()) / V << " scans per vertex"
+              << (same ? "" : " (results differ!)") << std::endl;
+}
+
+int main(int argc, char **argv) {
     std::cout << "Single Source Shorted Paths - BellmanFord Algorithm" << std::endl;
+    if (argc > 1 && std::string(argv[1]) == "--bench") {
+        benchmark(200000, 1000000);
+        return 0;
+    }
 
     Graph graph(5);
     graph.addNode("s");
@@ -163,5 +570,22 @@ int main() {
     BellmanFord bellmanFord(graph, "s");
     std::cout << "Shortest path exists from source: " << bellmanFord.compute() << std::endl;
     bellmanFord.print();
+
+    std::cout << "Worklist: " << bellmanFord.compute(BellmanFord::METHOD::WORKLIST)
+              << ", " << bellmanFord.vertexScans() << " vertex scans" << std::endl;
+    bellmanFord.print();
+
+    ThreadPool pool(2);
+    std::cout << "Parallel: " << bellmanFord.compute(pool) << std::endl;
+    bellmanFord.print();
+
+    graph.addEdge("x", "y", 1);
+    std::cout << "With arc x-->y of weight 1:" << std::endl;
+    std::cout << "Shortest path exists from source: " << bellmanFord.compute() << std::endl;
+    bellmanFord.print();
+    std::cout << "Worklist: " << bellmanFord.compute(BellmanFord::METHOD::WORKLIST) << std::endl;
+    bellmanFord.print();
+    std::cout << "Parallel: " << bellmanFord.compute(pool) << std::endl;
+    bellmanFord.print();
     return 0;
-}
\ No newline at end of file
+}
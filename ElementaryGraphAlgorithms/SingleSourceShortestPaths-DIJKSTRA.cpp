@@ -3,6 +3,18 @@
 #include <algorithm>
 #include <limits>
 #include <unordered_map>
+#include <memory>
+#include <string>
+#include <stdexcept>
+#include <chrono>
+#include <random>
+#include <atomic>
+#include <cstdint>
+#include <bit>
+
+#include "CSRGraph.h"
+#include "GraphLoaders.h"
+#include "PriorityQueues.h"
 
 class Graph {
 public:
@@ -21,7 +33,20 @@ public:
 
     Graph(int V) : V(V) {
         nodes.resize(V, Node());
-        adjList.resize(V, Edges());
+    }
+
+    //Wraps a loaded graph, its nodes are named by their ids. The CSR is
+    //taken as is, so edges must not be added afterwards. It needs weights,
+    //an unweighted binary graph has none.
+    Graph(CSRGraph csr) : V(csr.getV()), id(csr.getV()) {
+        if (!csr.weighted() && csr.getE() > 0)
+            throw std::runtime_error("Shortest paths need a weighted graph");
+
+        nodes.resize(V, Node());
+        for (int u = 0; u <= V-1; ++u) {
+            nodes[u] = Node{u, std::to_string(u)};
+        }
+        csrGraph = std::make_unique<CSRGraph>(std::move(csr));
     }
 
     void addNode(const std::string &u) {
@@ -35,21 +60,21 @@ public:
     void addEdge(const std::string& u, const std::string &v, int w) {
         Edge e{nodeMap[u], nodeMap[v], w};
         edges.emplace_back(e);
-        adjList[nodeMap[u]].emplace_back(e);
-    }
-
-    const Edges& getEdges(const std::string &u)  {
-        return adjList[nodeMap[u]];
-    }
-
-    const Edges& getEdges(int u)  {
-        return adjList[u];
+        csrGraph.reset();
     }
 
     const Edges& getEdges() const {
         return edges;
     }
 
+    //Adjacency in CSR form, built in bulk from the edge list on first use.
+    const CSRGraph& csr() const {
+        if (!csrGraph) {
+            csrGraph = std::make_unique<CSRGraph>(V, edges);
+        }
+        return *csrGraph;
+    }
+
     int getV() const { return V; }
 
     const Node& getNode(const std::string& u) const {
@@ -74,134 +99,1178 @@ private:
     Nodes nodes;
     Edges edges;
 
-    std::vector<Edges> adjList;
     std::unordered_map<std::string, int> nodeMap;
+    mutable std::unique_ptr<CSRGraph> csrGraph;
 };
 
-class MinHeap {
-    struct Node {
-        using Ptr = std::shared_ptr<Node>;
-
-        int id  = 0;
-        int key = 0;
+class DijkstraAlgorithm {
+public:
+    //AUTO takes Dial's buckets when the largest weight is at most
+    //DIAL_MAX_WEIGHT and DefaultQueue<int> (the radix heap) otherwise.
+    enum class QUEUE {
+        AUTO = 0,
+        BINARY_HEAP = 1,
+        HEAP = 2,
+        RADIX = 3,
+        DIAL = 4
     };
-public:  
-    MinHeap () {
-    }
+    static const int DIAL_MAX_WEIGHT = 1024;
 
-    void push(int item, int key) {
-        Node::Ptr ptr (new Node{item, key});
-        items.emplace_back(ptr);
-        map[item] = ptr;
-        heapProperty = false;
+    DijkstraAlgorithm(const Graph &graph, const std::string &source, QUEUE queue = QUEUE::AUTO) :
+        DijkstraAlgorithm(graph, graph.getNode(source).id, queue) {
     }
 
-    bool empty() const {
-        return items.empty();
+    DijkstraAlgorithm(const Graph &graph, int source, QUEUE queue = QUEUE::AUTO) :
+        graph(graph), source(source), queue(queue) {
+        parent.resize(graph.getV(), -1);
+        distance.resize(graph.getV(), INF);
     }
 
-    void update(int item, int key) {
-        map[item]->key = key;
-        map[item]->id = item;
-        heapProperty = false;
+    //Only reached vertices enter the queue, each is extracted once and relaxes
+    //its own out-arcs: O((V + E) log V) with the heaps.
+    void operator() () {
+        const CSRGraph &csr = graph.csr();
+        int V = graph.getV();
+        switch (queue) {
+        case QUEUE::BINARY_HEAP: {
+            BinaryHeap binaryHeap(V);
+            run(binaryHeap);
+            break;
+        }
+        case QUEUE::HEAP: {
+            MinHeap minHeap(V);
+            run(minHeap);
+            break;
+        }
+        case QUEUE::RADIX: {
+            RadixHeap radixHeap(V);
+            run(radixHeap);
+            break;
+        }
+        case QUEUE::DIAL: {
+            BucketQueue bucketQueue(V, maxWeight(csr));
+            run(bucketQueue);
+            break;
+        }
+        default: {
+            int w = maxWeight(csr);
+            if (w <= DIAL_MAX_WEIGHT) {
+                BucketQueue bucketQueue(V, w);
+                run(bucketQueue);
+            }
+            else {
+                DefaultQueue<int> defaultQueue(V);
+                run(defaultQueue);
+            }
+        }
+        }
     }
 
-    Node::Ptr extract() {
-        Node::Ptr ptr;
-        if (!empty()) {
-            
-            makeHeap();
+    void print() {
+        std::cout << "Single source[" << graph.getNode(source).name << "] shortest paths edges:" << std::endl;
+        for (int i = 0; i <= graph.getV()-1; ++i) {
+            if (parent[i] != -1) {
+                std::cout << graph.getNode(parent[i]).name << "-->" << graph.getNode(i).name << std::endl;
+            }
+        }
 
-            ptr = items.front();
-            items.erase(items.begin());
+        std::cout << "Single source[" << graph.getNode(source).name << "] shortest paths distance:" << std::endl;
+        for (int i = 0; i <= graph.getV()-1; ++i) {
+            std::cout << graph.getNode(i).name << ":" << distance[i] << std::endl;
         }
-        return ptr;
+    }
+
+    int getDistance(int u) const {
+        return distance[u];
+    }
+
+    int getParent(int u) const {
+        return parent[u];
     }
 
 private:
-    void makeHeap() {
-        if (empty())
-            return;
+    template <typename Queue>
+    void run(Queue &minHeap) {
+        std::fill(std::begin(distance), std::end(distance), INF);
+        std::fill(std::begin(parent), std::end(parent), -1);
+        minHeap.push(source, 0);
+        distance[source] = 0;
+
+        const CSRGraph &csr = graph.csr();
+        while(!minHeap.empty()) {
+            int u = minHeap.extract();
+            for (std::size_t arc = csr.begin(u); arc < csr.end(u); ++arc) {
+                relax(minHeap, u, csr.target(arc), csr.weight(arc));
+            }
+        }
+    }
 
-        if (!heapProperty) {
-            auto cmp = [](auto a, auto b) {
-                return a->key > b->key;
-            };
+    template <typename Queue>
+    void relax(Queue &minHeap, int u, int v, int w) {
+        if (distance[v] == INF || distance[v] > distance[u] + w) {
+            distance[v] = distance[u] + w;
+            minHeap.update(v, distance[v]);
+            parent[v] = u;
+        }
+    }
 
-            std::make_heap (std::begin(items), std::end(items), cmp);
-            heapProperty = true;
+    static int maxWeight(const CSRGraph &csr) {
+        int w = 0;
+        for (int x: csr.weightArray()) {
+            w = std::max(w, x);
         }
+        return w;
     }
 
-    std::vector<Node::Ptr> items;
-    std::unordered_map<int, Node::Ptr> map;
-    bool heapProperty = false;
+    const Graph &graph;
+    int source = 0;
+    QUEUE queue = QUEUE::AUTO;
+    std::vector<int> distance;
+    std::vector<int> parent;
+    int INF = std::numeric_limits<int>::max();
 };
 
-class DijkstraAlgorithm {
+//Parallel Delta-stepping (Meyer, Sanders). Tentative distances are kept in
+//buckets of width delta. The lowest non-empty bucket is settled by relaxing
+//the light arcs (w <= delta) of its vertices in parallel until it stops
+//refilling, then the heavy arcs of everything it settled are relaxed once.
+//
+//Each vertex's (distance, parent) pair is packed into one 64-bit word,
+//distance in the high half, and updated with an atomic min. Ties on
+//distance therefore resolve to the smallest parent id, and the result does
+//not depend on thread timing. Distances equal DijkstraAlgorithm's, and
+//parents are the smallest-id predecessor on a shortest path.
+//
+//Queued vertices never lie more than maxWeight / delta + 1 buckets above the
+//current one, so the buckets form a ring of that many slots (at most
+//RING_MAX), indexed by bucket % slots. A bitmap of non-empty slots lets the
+//scan jump to the next non-empty bucket. Vertices beyond the ring, only
+//possible when it is capped, wait in an overflow list that is spread into
+//the ring before the scan would pass its lowest bucket. Memory is
+//O(V + E) whatever delta is.
+class DeltaStepping {
 public:
-    DijkstraAlgorithm(const Graph &graph, const std::string &source) : graph(graph), source(source) {
+    static constexpr std::size_t RING_MAX = 1 << 16;
+
+    DeltaStepping(const Graph &graph, const std::string &source, ThreadPool &pool, int delta = 0) :
+        DeltaStepping(graph, graph.getNode(source).id, pool, delta) {
+    }
+
+    //delta <= 0 picks the mean arc weight.
+    DeltaStepping(const Graph &graph, int source, ThreadPool &pool, int delta = 0) :
+        graph(graph), source(source), pool(pool), delta(delta > 0 ? delta : meanWeight(graph.csr())) {
         parent.resize(graph.getV(), -1);
         distance.resize(graph.getV(), INF);
     }
 
     void operator() () {
-        initialize();
+        const CSRGraph &csr = graph.csr();
+        int V = graph.getV();
+        std::vector<std::uint64_t> best(V, UNREACHED);
+        best[source] = pack(0, NO_PARENT);
 
-        while(!minHeap.empty()) {
-            int u = minHeap.extract()->id;
-            for (const auto & e : graph.getEdges() ) {
-                relax(e);
+        std::size_t slots = std::min<std::size_t>(RING_MAX, static_cast<std::size_t>(maxWeight(csr) / delta) + 2);
+        std::vector<std::vector<int>> buckets(slots);
+        std::vector<std::uint64_t> occupied((slots + 63) / 64, 0);
+        std::vector<int> overflow;
+        std::size_t overflowLow = std::numeric_limits<std::size_t>::max();
+        std::size_t current = 0;
+        std::vector<std::vector<int>> improved(pool.size());
+        std::vector<char> settled(V, 0);
+        std::vector<int> frontier;
+        std::vector<int> settledNow;
+
+        auto bucketOf = [&](int v) {
+            return static_cast<std::size_t>(best[v] >> 32) / delta;
+        };
+        auto enqueue = [&](int v) {
+            std::size_t b = bucketOf(v);
+            if (b - current >= slots) {
+                overflow.emplace_back(v);
+                overflowLow = std::min(overflowLow, b);
+                return;
+            }
+            std::size_t slot = b % slots;
+            buckets[slot].emplace_back(v);
+            occupied[slot / 64] |= std::uint64_t(1) << (slot % 64);
+        };
+        //Lowest non-empty bucket in the ring at or after current.
+        auto nextInRing = [&]() {
+            std::size_t start = current % slots;
+            for (std::size_t step = 0; step <= occupied.size(); ++step) {
+                std::size_t word = (start / 64 + step) % occupied.size();
+                std::uint64_t bits = occupied[word];
+                if (step == 0)
+                    bits &= ~std::uint64_t(0) << (start % 64);
+                else if (step == occupied.size())
+                    bits &= (std::uint64_t(1) << (start % 64)) - 1;
+                if (bits) {
+                    std::size_t slot = word * 64 + std::countr_zero(bits);
+                    return current + (slot + slots - start) % slots;
+                }
+            }
+            return std::numeric_limits<std::size_t>::max();
+        };
+        //Moves current to the next non-empty bucket, false when none is left.
+        //Overflow entries are spread into the ring first when they might come
+        //before that bucket, entries of vertices settled meanwhile fall below
+        //current and are dropped.
+        auto advance = [&]() {
+            while (true) {
+                std::size_t next = nextInRing();
+                if (overflow.empty() || overflowLow > next) {
+                    current = next;
+                    return next != std::numeric_limits<std::size_t>::max();
+                }
+
+                std::vector<int> waiting;
+                waiting.swap(overflow);
+                overflowLow = std::numeric_limits<std::size_t>::max();
+                std::size_t lowest = next;
+                for (int v: waiting) {
+                    if (bucketOf(v) >= current)
+                        lowest = std::min(lowest, bucketOf(v));
+                }
+                if (lowest == std::numeric_limits<std::size_t>::max())
+                    return false;
+
+                current = lowest;
+                for (int v: waiting) {
+                    if (bucketOf(v) >= current)
+                        enqueue(v);
+                }
+            }
+        };
+
+        auto relaxArcs = [&](const std::vector<int> &vertices, bool light) {
+            pool.parallelFor(0, vertices.size(), [&](std::size_t i, int t) {
+                int u = vertices[i];
+                std::uint64_t du = std::atomic_ref<std::uint64_t>(best[u]).load(std::memory_order_relaxed) >> 32;
+                for (std::size_t arc = csr.begin(u); arc < csr.end(u); ++arc) {
+                    int w = csr.weight(arc);
+                    if ((w <= delta) != light)
+                        continue;
+
+                    int v = csr.target(arc);
+                    if (v != source && relax(best[v], pack(du + w, u)))
+                        improved[t].emplace_back(v);
+                }
+            }, 64);
+
+            for (auto &list: improved) {
+                for (int v: list) {
+                    enqueue(v);
+                }
+                list.clear();
+            }
+        };
+
+        enqueue(source);
+        while (advance()) {
+            std::vector<int> &bucket = buckets[current % slots];
+            settledNow.clear();
+            while (!bucket.empty()) {
+                //Drop entries that moved to a lower bucket since they were queued
+                //and duplicates within the bucket.
+                frontier.clear();
+                for (int v: bucket) {
+                    if (bucketOf(v) == current && !settled[v]) {
+                        settled[v] = 1;
+                        frontier.emplace_back(v);
+                    }
+                }
+                bucket.clear();
+                for (int v: frontier) {
+                    settled[v] = 0;
+                }
+
+                relaxArcs(frontier, true);
+                settledNow.insert(std::end(settledNow), std::begin(frontier), std::end(frontier));
+            }
+            occupied[current % slots / 64] &= ~(std::uint64_t(1) << (current % slots % 64));
+
+            std::sort(std::begin(settledNow), std::end(settledNow));
+            settledNow.erase(std::unique(std::begin(settledNow), std::end(settledNow)), std::end(settledNow));
+            relaxArcs(settledNow, false);
+        }
+
+        for (int u = 0; u <= V-1; ++u) {
+            if (best[u] != UNREACHED) {
+                distance[u] = static_cast<int>(best[u] >> 32);
+                std::uint32_t p = static_cast<std::uint32_t>(best[u]);
+                parent[u] = p == NO_PARENT ? -1 : static_cast<int>(p);
             }
         }
-        
     }
 
     void print() {
-        std::cout << "Single source[" << source << "] shortest paths edges:" << std::endl;
+        std::cout << "Single source[" << graph.getNode(source).name << "] shortest paths edges:" << std::endl;
         for (int i = 0; i <= graph.getV()-1; ++i) {
             if (parent[i] != -1) {
                 std::cout << graph.getNode(parent[i]).name << "-->" << graph.getNode(i).name << std::endl;
             }
         }
 
-        std::cout << "Single source[" << source << "] shortest paths distance:" << std::endl;
+        std::cout << "Single source[" << graph.getNode(source).name << "] shortest paths distance:" << std::endl;
         for (int i = 0; i <= graph.getV()-1; ++i) {
             std::cout << graph.getNode(i).name << ":" << distance[i] << std::endl;
         }
     }
 
+    int getDistance(int u) const {
+        return distance[u];
+    }
+
+    int getParent(int u) const {
+        return parent[u];
+    }
+
 private:
-    void initialize() {
-        for (const auto & node: graph.getNodes()) {
-            minHeap.push(node.id, INF);
+    static constexpr std::uint64_t UNREACHED = ~std::uint64_t(0);
+    static constexpr std::uint32_t NO_PARENT = ~std::uint32_t(0);
+
+    static std::uint64_t pack(std::uint64_t d, std::uint32_t p) {
+        return (d << 32) | p;
+    }
+
+    static bool relax(std::uint64_t &slot, std::uint64_t value) {
+        std::atomic_ref<std::uint64_t> ref(slot);
+        std::uint64_t current = ref.load(std::memory_order_relaxed);
+        while (value < current) {
+            if (ref.compare_exchange_weak(current, value, std::memory_order_relaxed))
+                return true;
         }
+        return false;
+    }
 
-        Graph::Node s = graph.getNode(source);
-        minHeap.update(s.id, 0);
-        distance[s.id] = 0;
+    static int maxWeight(const CSRGraph &csr) {
+        int w = 0;
+        for (int x: csr.weightArray()) {
+            w = std::max(w, x);
+        }
+        return w;
     }
 
-    void relax(const Graph::Edge &e) {
-        if (distance[e.v] == INF || distance[e.v] > distance[e.u] + e.w) {
-            int w = distance[e.u] +  e.w;
-            distance[e.v] = w;
-            minHeap.update(e.v, w);
-            parent[e.v] = e.u;
+    static int meanWeight(const CSRGraph &csr) {
+        long long sum = 0;
+        for (int w: csr.weightArray()) {
+            sum += w;
         }
+        return csr.getE() ? std::max<long long>(1, sum / static_cast<long long>(csr.getE())) : 1;
     }
 
     const Graph &graph;
-    const std::string &source;
+    int source = 0;
+    ThreadPool &pool;
+    int delta = 1;
     std::vector<int> distance;
     std::vector<int> parent;
     int INF = std::numeric_limits<int>::max();
-    MinHeap minHeap;
+};
+
+//Single source, all targets distances over a bare CSRGraph.
+std::vector<int> distancesFrom(const CSRGraph &csr, int source) {
+    const int INF = std::numeric_limits<int>::max();
+    std::vector<int> distance(csr.getV(), INF);
+    MinHeap minHeap(csr.getV());
+    distance[source] = 0;
+    minHeap.push(source, 0);
+    while (!minHeap.empty()) {
+        int u = minHeap.extract();
+        for (std::size_t arc = csr.begin(u); arc < csr.end(u); ++arc) {
+            int v = csr.target(arc);
+            int d = distance[u] + csr.weight(arc);
+            if (d < distance[v]) {
+                distance[v] = d;
+                minHeap.update(v, d);
+            }
+        }
+    }
+    return distance;
+}
 
+//A* heuristics give a lower bound on dist(u, v) for any pair, which serves
+//the forward search (bound to the target) and the backward one (bound from
+//the source) alike. They must be consistent (feasible potentials).
+struct ZeroHeuristic {
+    int lowerBound(int, int) const {
+        return 0;
+    }
 };
 
-int main() {
+//ALT (A*, landmarks, triangle inequality): with exact distances from and to
+//a few landmarks L, dist(u, v) >= dist(L, v) - dist(L, u) and
+//dist(u, v) >= dist(u, L) - dist(v, L). Landmarks are picked greedily, each
+//one the vertex farthest from those already chosen.
+class LandmarkHeuristic {
+public:
+    LandmarkHeuristic(const Graph &graph, int landmarks) {
+        const CSRGraph &csr = graph.csr();
+        CSRGraph reverse = csr.transpose();
+        int V = graph.getV();
+        std::vector<int> nearest(V, INF);
+
+        int next = 0;
+        for (int i = 0; i <= landmarks-1 && V > 0; ++i) {
+            from.emplace_back(distancesFrom(csr, next));
+            to.emplace_back(distancesFrom(reverse, next));
+
+            int farthest = -1;
+            for (int v = 0; v <= V-1; ++v) {
+                if (from.back()[v] != INF)
+                    nearest[v] = std::min(nearest[v], from.back()[v]);
+                if (nearest[v] != INF && nearest[v] > 0 && (farthest == -1 || nearest[v] > nearest[farthest]))
+                    farthest = v;
+            }
+            if (farthest == -1)
+                break;
+            next = farthest;
+        }
+    }
+
+    int lowerBound(int u, int v) const {
+        int bound = 0;
+        for (std::size_t l = 0; l < from.size(); ++l) {
+            if (from[l][u] != INF && from[l][v] != INF)
+                bound = std::max(bound, from[l][v] - from[l][u]);
+            if (to[l][u] != INF && to[l][v] != INF)
+                bound = std::max(bound, to[l][u] - to[l][v]);
+        }
+        return bound;
+    }
+
+private:
+    static constexpr int INF = std::numeric_limits<int>::max();
+
+    std::vector<std::vector<int>> from;
+    std::vector<std::vector<int>> to;
+};
+
+//Point-to-point shortest path queries that stop as soon as the answer is
+//known: the unidirectional search when the target is extracted, the
+//bidirectional one when the two queue minima together reach the best meeting
+//path found so far. A* potentials from Heuristic steer both searches, the
+//bidirectional one uses the average of the forward and backward bounds so
+//both directions see the same consistent reduced costs (kept doubled to stay
+//in integers).
+//
+//Per-query state is never reset: every entry carries the number of the query
+//that last wrote it and anything older reads as unvisited.
+template <typename Heuristic = ZeroHeuristic>
+class PointToPointQuery {
+public:
+    enum class MODE {
+        UNIDIRECTIONAL = 0,
+        BIDIRECTIONAL = 1
+    };
+
+    PointToPointQuery(const Graph &graph, Heuristic heuristic = Heuristic()) :
+        graph(graph), heuristic(std::move(heuristic)),
+        forward(graph.csr(), graph.getV()), reverse(graph.csr().transpose()), backward(reverse, graph.getV()) {
+    }
+
+    //Returns the distance from s to t, or INF when t is unreachable.
+    int operator() (int s, int t, MODE mode = MODE::BIDIRECTIONAL) {
+        this->s = s;
+        this->t = t;
+        meeting = -1;
+        best = INF;
+        ++version;
+        forward.reset(version);
+        backward.reset(version);
+
+        if (mode == MODE::UNIDIRECTIONAL)
+            unidirectional();
+        else
+            bidirectional();
+        return best;
+    }
+
+    int operator() (const std::string &s, const std::string &t, MODE mode = MODE::BIDIRECTIONAL) {
+        return (*this)(graph.getNode(s).id, graph.getNode(t).id, mode);
+    }
+
+    //Vertices of the last query's shortest path, s first, empty if none.
+    std::vector<int> path() const {
+        std::vector<int> nodes;
+        if (meeting == -1)
+            return nodes;
+
+        for (int u = meeting; u != -1; u = forward.parentOf(u)) {
+            nodes.emplace_back(u);
+        }
+        std::reverse(std::begin(nodes), std::end(nodes));
+        for (int u = backward.parentOf(meeting); u != -1; u = backward.parentOf(u)) {
+            nodes.emplace_back(u);
+        }
+        return nodes;
+    }
+
+    //Vertices extracted by the last query in both directions.
+    int settled() const {
+        return forward.settled + backward.settled;
+    }
+
+    void print() const {
+        std::cout << "Shortest path " << graph.getNode(s).name << "-->" << graph.getNode(t).name << ":";
+        for (int u: path()) {
+            std::cout << " " << graph.getNode(u).name;
+        }
+        std::cout << std::endl << "Distance: " << best << ", settled: " << settled() << std::endl;
+    }
+
+private:
+    static constexpr int INF = std::numeric_limits<int>::max();
+
+    struct Search {
+        Search(const CSRGraph &csr, int V) : csr(csr), distance(V), parent(V), stamp(V, 0), minHeap(V) {
+        }
+
+        void reset(std::uint32_t v) {
+            version = v;
+            settled = 0;
+            minHeap.clear();
+        }
+
+        bool reached(int u) const {
+            return stamp[u] == version;
+        }
+
+        int distanceOf(int u) const {
+            return reached(u) ? distance[u] : INF;
+        }
+
+        int parentOf(int u) const {
+            return reached(u) ? parent[u] : -1;
+        }
+
+        //Records a better distance for v, returns false if it is not better.
+        bool improve(int v, int d, int p) {
+            if (reached(v) && distance[v] <= d)
+                return false;
+            stamp[v] = version;
+            distance[v] = d;
+            parent[v] = p;
+            return true;
+        }
+
+        const CSRGraph &csr;
+        std::vector<int> distance;
+        std::vector<int> parent;
+        std::vector<std::uint32_t> stamp;
+        std::uint32_t version = 0;
+        MinHeap minHeap;
+        int settled = 0;
+    };
+
+    void unidirectional() {
+        forward.improve(s, 0, -1);
+        forward.minHeap.push(s, heuristic.lowerBound(s, t));
+        while (!forward.minHeap.empty()) {
+            int u = forward.minHeap.extract();
+            ++forward.settled;
+            if (u == t) {
+                best = forward.distance[t];
+                meeting = t;
+                return;
+            }
+
+            const CSRGraph &csr = forward.csr;
+            for (std::size_t arc = csr.begin(u); arc < csr.end(u); ++arc) {
+                int v = csr.target(arc);
+                int d = forward.distance[u] + csr.weight(arc);
+                if (forward.improve(v, d, u))
+                    forward.minHeap.update(v, d + heuristic.lowerBound(v, t));
+            }
+        }
+    }
+
+    //Doubled forward potential, h(u -> t) - h(s -> u); the backward search
+    //uses its negation.
+    int potential(int u) const {
+        return heuristic.lowerBound(u, t) - heuristic.lowerBound(s, u);
+    }
+
+    void bidirectional() {
+        if (s == t) {
+            forward.improve(s, 0, -1);
+            best = 0;
+            meeting = s;
+            return;
+        }
+
+        forward.improve(s, 0, -1);
+        forward.minHeap.push(s, potential(s));
+        backward.improve(t, 0, -1);
+        backward.minHeap.push(t, -potential(t));
+
+        while (!forward.minHeap.empty() && !backward.minHeap.empty()) {
+            long long top = static_cast<long long>(forward.minHeap.topKey()) + backward.minHeap.topKey();
+            if (best != INF && top >= 2LL * best)
+                return;
+
+            if (forward.minHeap.size() <= backward.minHeap.size())
+                step(forward, backward, 1);
+            else
+                step(backward, forward, -1);
+        }
+    }
+
+    void step(Search &search, Search &other, int sign) {
+        int u = search.minHeap.extract();
+        ++search.settled;
+
+        const CSRGraph &csr = search.csr;
+        for (std::size_t arc = csr.begin(u); arc < csr.end(u); ++arc) {
+            int v = csr.target(arc);
+            int d = search.distance[u] + csr.weight(arc);
+            if (search.improve(v, d, u))
+                search.minHeap.update(v, 2 * d + sign * potential(v));
+
+            if (other.reached(v) && d + other.distance[v] < best) {
+                best = d + other.distance[v];
+                meeting = v;
+            }
+        }
+    }
+
+    const Graph &graph;
+    Heuristic heuristic;
+    Search forward;
+    CSRGraph reverse;
+    Search backward;
+    std::uint32_t version = 0;
+    int s = 0;
+    int t = 0;
+    int meeting = -1;
+    int best = INF;
+};
+
+//Contraction Hierarchies (Geisberger et al.). Preprocessing contracts the
+//vertices one by one in order of importance, the edge difference (shortcuts
+//a contraction adds minus arcs it removes) plus the number of already
+//contracted neighbours, with lazy re-evaluation. Contracting v adds a shortcut
+//u -> w for each pair of remaining in/out neighbours unless a bounded witness
+//search finds a path u -> w avoiding v that is no longer.
+//
+//Every arc then leads either up or down the order. Queries run a
+//bidirectional Dijkstra that only climbs: forward over the upward CSR from s,
+//backward over the downward CSR (in-arcs from higher vertices) from t, so
+//each side settles only a few hundred vertices on road networks. The found
+//path is unpacked through the middle vertex stored for every shortcut.
+class ContractionHierarchy {
+public:
+    //Vertices a witness search may settle before it gives up and the shortcut
+    //is added anyway, which only costs an unnecessary arc.
+    static const int WITNESS_SETTLE_LIMIT = 500;
+
+    ContractionHierarchy(const Graph &graph) :
+        graph(graph), rank(graph.getV(), 0), witness(graph.getV()), forward(graph.getV()), backward(graph.getV()) {
+        preprocess();
+    }
+
+    //Returns the distance from s to t, or INF when t is unreachable.
+    int operator() (int s, int t) {
+        this->s = s;
+        this->t = t;
+        best = INF;
+        meeting = -1;
+        ++version;
+        forward.reset(version);
+        backward.reset(version);
+
+        forward.improve(s, 0, -1);
+        forward.minHeap.push(s, 0);
+        backward.improve(t, 0, -1);
+        backward.minHeap.push(t, 0);
+
+        while (true) {
+            bool forwardOpen = !forward.minHeap.empty() && forward.minHeap.topKey() < best;
+            bool backwardOpen = !backward.minHeap.empty() && backward.minHeap.topKey() < best;
+            if (!forwardOpen && !backwardOpen)
+                break;
+
+            if (forwardOpen && (!backwardOpen || forward.minHeap.size() <= backward.minHeap.size()))
+                step(forward, backward, upward);
+            else
+                step(backward, forward, downward);
+        }
+        return best;
+    }
+
+    int operator() (const std::string &s, const std::string &t) {
+        return (*this)(graph.getNode(s).id, graph.getNode(t).id);
+    }
+
+    //Vertices of the last query's shortest path in the original graph,
+    //shortcuts unpacked, s first.
+    std::vector<int> path() const {
+        std::vector<int> nodes;
+        if (meeting == -1)
+            return nodes;
+
+        std::vector<int> up;
+        for (int u = meeting; u != -1; u = forward.parentOf(u)) {
+            up.emplace_back(u);
+        }
+        std::reverse(std::begin(up), std::end(up));
+
+        nodes.emplace_back(up.front());
+        for (std::size_t i = 0; i + 1 < up.size(); ++i) {
+            unpack(up[i], up[i+1], nodes);
+        }
+        for (int u = meeting; backward.parentOf(u) != -1; u = backward.parentOf(u)) {
+            unpack(u, backward.parentOf(u), nodes);
+        }
+        return nodes;
+    }
+
+    int settled() const {
+        return forward.settled + backward.settled;
+    }
+
+    std::size_t shortcuts() const {
+        return shortcutCount;
+    }
+
+    //Same form as DijkstraAlgorithm::print, for the vertices on the route.
+    void print() const {
+        std::vector<int> nodes = path();
+        std::cout << "Route[" << graph.getNode(s).name << "-->" << graph.getNode(t).name << "] shortest path edges:" << std::endl;
+        for (std::size_t i = 0; i + 1 < nodes.size(); ++i) {
+            std::cout << graph.getNode(nodes[i]).name << "-->" << graph.getNode(nodes[i+1]).name << std::endl;
+        }
+        std::cout << "Route[" << graph.getNode(s).name << "-->" << graph.getNode(t).name << "] distance: " << best
+                  << " (settled " << settled() << ")" << std::endl;
+    }
+
+private:
+    static constexpr int INF = std::numeric_limits<int>::max();
+
+    struct Arc {
+        int to = 0;
+        int w = 0;
+        int middle = -1;
+    };
+
+    struct HierarchyEdge {
+        int u = 0;
+        int v = 0;
+        int w = 0;
+    };
+
+    //Dijkstra state stamped with a search number, see PointToPointQuery.
+    struct Search {
+        Search(int V) : distance(V), parent(V), stamp(V, 0), minHeap(V) {
+        }
+
+        void reset(std::uint32_t v) {
+            version = v;
+            settled = 0;
+            minHeap.clear();
+        }
+
+        bool reached(int u) const {
+            return stamp[u] == version;
+        }
+
+        int distanceOf(int u) const {
+            return reached(u) ? distance[u] : INF;
+        }
+
+        int parentOf(int u) const {
+            return reached(u) ? parent[u] : -1;
+        }
+
+        bool improve(int v, int d, int p) {
+            if (reached(v) && distance[v] <= d)
+                return false;
+            stamp[v] = version;
+            distance[v] = d;
+            parent[v] = p;
+            return true;
+        }
+
+        std::vector<int> distance;
+        std::vector<int> parent;
+        std::vector<std::uint32_t> stamp;
+        std::uint32_t version = 0;
+        MinHeap minHeap;
+        int settled = 0;
+    };
+
+    static std::uint64_t key(int u, int v) {
+        return (static_cast<std::uint64_t>(u) << 32) | static_cast<std::uint32_t>(v);
+    }
+
+    void preprocess() {
+        const CSRGraph &csr = graph.csr();
+        int V = graph.getV();
+        out.assign(V, {});
+        in.assign(V, {});
+        for (int u = 0; u <= V-1; ++u) {
+            for (std::size_t arc = csr.begin(u); arc < csr.end(u); ++arc) {
+                if (csr.target(arc) != u)
+                    addArc(u, csr.target(arc), csr.weight(arc), -1);
+            }
+        }
+
+        std::vector<int> contractedNeighbors(V, 0);
+        std::vector<char> contracted(V, 0);
+        MinHeap order(V);
+        for (int v = 0; v <= V-1; ++v) {
+            order.push(v, priority(v, 0));
+        }
+
+        std::vector<HierarchyEdge> upArcs;
+        std::vector<HierarchyEdge> downArcs;
+        for (int next = 0; !order.empty(); ) {
+            int v = order.extract();
+            int current = priority(v, contractedNeighbors[v]);
+            if (!order.empty() && current > order.topKey()) {
+                order.push(v, current);
+                continue;
+            }
+
+            rank[v] = next++;
+            contract(v, true);
+            contracted[v] = 1;
+
+            //v's remaining arcs all lead to vertices contracted later, i.e.
+            //up the hierarchy, and are final from here on.
+            for (auto &arc: out[v]) {
+                upArcs.emplace_back(HierarchyEdge{v, arc.to, arc.w});
+                middles[key(v, arc.to)] = arc.middle;
+            }
+            for (auto &arc: in[v]) {
+                downArcs.emplace_back(HierarchyEdge{v, arc.to, arc.w});
+                middles[key(arc.to, v)] = arc.middle;
+            }
+
+            for (auto &arc: out[v]) {
+                removeArc(in[arc.to], v);
+                ++contractedNeighbors[arc.to];
+            }
+            for (auto &arc: in[v]) {
+                removeArc(out[arc.to], v);
+                ++contractedNeighbors[arc.to];
+            }
+            out[v].clear();
+            in[v].clear();
+        }
+
+        out.clear();
+        in.clear();
+        upward = CSRGraph(V, upArcs);
+        downward = CSRGraph(V, downArcs);
+    }
+
+    int priority(int v, int contractedNeighbors) {
+        int added = contract(v, false);
+        return added - static_cast<int>(in[v].size() + out[v].size()) + contractedNeighbors;
+    }
+
+    //Returns the number of shortcuts contracting v needs, adding them when
+    //apply is set.
+    int contract(int v, bool apply) {
+        //Shortcuts only touch the lists of v's neighbours, never v's own.
+        int added = 0;
+        for (auto &arcIn: in[v]) {
+            int u = arcIn.to;
+            int limit = -1;
+            for (auto &arcOut: out[v]) {
+                if (arcOut.to != u)
+                    limit = std::max(limit, arcIn.w + arcOut.w);
+            }
+            if (limit == -1)
+                continue;
+
+            witnessSearch(u, v, limit);
+            for (auto &arcOut: out[v]) {
+                int w = arcOut.to;
+                if (w == u)
+                    continue;
+
+                int via = arcIn.w + arcOut.w;
+                if (witness.distanceOf(w) <= via)
+                    continue;
+
+                ++added;
+                if (apply)
+                    addArc(u, w, via, v);
+            }
+        }
+        return added;
+    }
+
+    //Dijkstra from u over the remaining graph without v, up to distance limit.
+    void witnessSearch(int u, int v, int limit) {
+        witness.reset(++version);
+        witness.improve(u, 0, -1);
+        witness.minHeap.push(u, 0);
+        while (!witness.minHeap.empty() && witness.settled < WITNESS_SETTLE_LIMIT) {
+            int x = witness.minHeap.extract();
+            ++witness.settled;
+            if (witness.distance[x] > limit)
+                break;
+
+            for (auto &arc: out[x]) {
+                if (arc.to == v)
+                    continue;
+                int d = witness.distance[x] + arc.w;
+                if (d <= limit && witness.improve(arc.to, d, x))
+                    witness.minHeap.update(arc.to, d);
+            }
+        }
+    }
+
+    void addArc(int u, int w, int weight, int middle) {
+        for (auto &arc: out[u]) {
+            if (arc.to == w) {
+                if (weight < arc.w) {
+                    arc.w = weight;
+                    arc.middle = middle;
+                    for (auto &back: in[w]) {
+                        if (back.to == u) {
+                            back.w = weight;
+                            back.middle = middle;
+                        }
+                    }
+                }
+                return;
+            }
+        }
+        out[u].emplace_back(Arc{w, weight, middle});
+        in[w].emplace_back(Arc{u, weight, middle});
+        shortcutCount += middle != -1;
+    }
+
+    static void removeArc(std::vector<Arc> &arcs, int to) {
+        arcs.erase(std::remove_if(std::begin(arcs), std::end(arcs), [to](const Arc &arc) { return arc.to == to; }),
+                   std::end(arcs));
+    }
+
+    void step(Search &search, Search &other, const CSRGraph &csr) {
+        int u = search.minHeap.extract();
+        ++search.settled;
+        if (other.reached(u) && search.distance[u] + other.distance[u] < best) {
+            best = search.distance[u] + other.distance[u];
+            meeting = u;
+        }
+
+        for (std::size_t arc = csr.begin(u); arc < csr.end(u); ++arc) {
+            int v = csr.target(arc);
+            int d = search.distance[u] + csr.weight(arc);
+            if (search.improve(v, d, u))
+                search.minHeap.update(v, d);
+        }
+    }
+
+    //Appends the original vertices after u on arc u -> w, w included.
+    void unpack(int u, int w, std::vector<int> &nodes) const {
+        int middle = middles.at(key(u, w));
+        if (middle == -1) {
+            nodes.emplace_back(w);
+            return;
+        }
+        unpack(u, middle, nodes);
+        unpack(middle, w, nodes);
+    }
+
+    const Graph &graph;
+    std::vector<int> rank;
+    std::vector<std::vector<Arc>> out;
+    std::vector<std::vector<Arc>> in;
+    std::unordered_map<std::uint64_t, int> middles;
+    std::size_t shortcutCount = 0;
+
+    Search witness;
+    CSRGraph upward;
+    CSRGraph downward;
+    Search forward;
+    Search backward;
+    std::uint32_t version = 0;
+    int s = 0;
+    int t = 0;
+    int meeting = -1;
+    int best = INF;
+};
+
+//side x side grid with arcs both ways between 4-neighbours. With keep < 1
+//part of the streets are dropped and weights spread wider, which looks more
+//like a road network than a uniform lattice.
+CSRGraph gridGraph(int side, int maxWeight, double keep, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> weight(1, maxWeight);
+    std::bernoulli_distribution street(keep);
+
+    std::vector<GraphLoader::Edge> edges;
+    auto connect = [&](int u, int v) {
+        if (!street(rng))
+            return;
+        int w = weight(rng);
+        edges.emplace_back(GraphLoader::Edge{u, v, w});
+        edges.emplace_back(GraphLoader::Edge{v, u, w});
+    };
+
+    for (int r = 0; r <= side-1; ++r) {
+        for (int c = 0; c <= side-1; ++c) {
+            int u = r * side + c;
+            if (c + 1 < side)
+                connect(u, u + 1);
+            if (r + 1 < side)
+                connect(u, u + side);
+        }
+    }
+    return CSRGraph(side * side, edges);
+}
+
+//Times every queue on the same sources and checks they agree on distances.
+void benchmark(const std::string &name, const Graph &graph) {
+    using QUEUE = DijkstraAlgorithm::QUEUE;
+    const std::vector<std::pair<QUEUE, std::string>> queues {
+        {QUEUE::BINARY_HEAP, "binary heap"},
+        {QUEUE::HEAP, "4-ary heap"},
+        {QUEUE::RADIX, "radix heap"},
+        {QUEUE::DIAL, "dial buckets"}
+    };
+    const int RUNS = 3;
+
+    std::cout << name << ": V=" << graph.getV() << " E=" << graph.csr().getE() << std::endl;
+    std::vector<int> reference;
+    auto distances = [&](const auto &shortestPath) {
+        std::vector<int> distance(graph.getV());
+        for (int u = 0; u <= graph.getV()-1; ++u) {
+            distance[u] = shortestPath.getDistance(u);
+        }
+        return distance;
+    };
+    for (auto &[queue, label] : queues) {
+        double seconds = 0;
+        bool same = true;
+        for (int run = 0; run <= RUNS-1; ++run) {
+            int source = static_cast<int>((static_cast<long long>(run) * 7919) % graph.getV());
+            DijkstraAlgorithm shortestPath(graph, source, queue);
+            auto start = std::chrono::steady_clock::now();
+            shortestPath();
+            seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            if (run == 0) {
+                if (reference.empty())
+                    reference = distances(shortestPath);
+                same = distances(shortestPath) == reference;
+            }
+        }
+        std::cout << "  " << label << ": " << seconds / RUNS * 1000 << " ms"
+                  << (same ? "" : " (distances differ!)") << std::endl;
+    }
+
+    //The default delta (mean weight) and delta 1, which with large weights
+    //spans far more buckets than the ring holds.
+    ThreadPool pool;
+    for (int delta: {0, 1}) {
+        DeltaStepping deltaStepping(graph, 0, pool, delta);
+        auto start = std::chrono::steady_clock::now();
+        deltaStepping();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "  delta-stepping (" << pool.size() << " threads, " << (delta ? "delta 1" : "mean weight delta")
+                  << "): " << seconds * 1000 << " ms"
+                  << (distances(deltaStepping) == reference ? "" : " (distances differ!)") << std::endl;
+    }
+}
+
+//Random point-to-point queries, checked against a full Dijkstra run.
+void benchmarkQueries(const std::string &name, const Graph &graph) {
+    const int QUERIES = 50;
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> pick(0, graph.getV() - 1);
+    std::vector<std::pair<int, int>> queries(QUERIES);
+    for (auto &q: queries) {
+        q = {pick(rng), pick(rng)};
+    }
+
+    std::vector<int> expected;
+    for (auto &[s, t]: queries) {
+        DijkstraAlgorithm shortestPath(graph, s);
+        shortestPath();
+        expected.emplace_back(shortestPath.getDistance(t));
+    }
+
+    std::cout << name << ": " << QUERIES << " point-to-point queries" << std::endl;
+    auto measure = [&](const std::string &label, auto &query, auto... mode) {
+        long long settled = 0;
+        bool same = true;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i <= QUERIES-1; ++i) {
+            same &= query(queries[i].first, queries[i].second, mode...) == expected[i];
+            settled += query.settled();
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "  " << label << ": " << seconds / QUERIES * 1000 << " ms/query, "
+                  << settled / QUERIES << " settled/query" << (same ? "" : " (distances differ!)") << std::endl;
+    };
+
+    using Plain = PointToPointQuery<ZeroHeuristic>;
+    using ALT = PointToPointQuery<LandmarkHeuristic>;
+    Plain plain(graph);
+    ALT alt(graph, LandmarkHeuristic(graph, 8));
+    measure("dijkstra, early exit", plain, Plain::MODE::UNIDIRECTIONAL);
+    measure("bidirectional dijkstra", plain, Plain::MODE::BIDIRECTIONAL);
+    measure("A* (ALT, 8 landmarks)", alt, ALT::MODE::UNIDIRECTIONAL);
+    measure("bidirectional A* (ALT)", alt, ALT::MODE::BIDIRECTIONAL);
+
+    auto start = std::chrono::steady_clock::now();
+    ContractionHierarchy hierarchy(graph);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "  contraction hierarchy: " << seconds << " s preprocessing, "
+              << hierarchy.shortcuts() << " shortcuts" << std::endl;
+    measure("contraction hierarchy query", hierarchy);
+}
+
+//Loads a graph file by extension (.gr DIMACS, .bin binary, else SNAP edge
+//list) and runs the algorithm from vertex 0.
+int runFile(const std::string &path) {
+    ThreadPool pool;
+    GraphLoader loader(pool);
+    auto hasSuffix = [&](const std::string &suffix) {
+        return path.size() >= suffix.size() && path.compare(path.size() - suffix.size(), suffix.size(), suffix) == 0;
+    };
+
+    CSRGraph csr = hasSuffix(".gr") ? loader.loadDimacs(path)
+                 : hasSuffix(".bin") ? GraphLoader::loadBinary(path)
+                 : loader.loadEdgeList(path);
+    std::cout << "Loaded " << path << ": V=" << csr.getV() << " E=" << csr.getE() << std::endl;
+
+    Graph graph(std::move(csr));
+    DijkstraAlgorithm shortestPath(graph, 0);
+    shortestPath();
+
+    int reached = 0;
+    for (int u = 0; u <= graph.getV()-1; ++u) {
+        reached += shortestPath.getDistance(u) != std::numeric_limits<int>::max();
+    }
+    std::cout << "Reached " << reached << " nodes from 0" << std::endl;
+    return 0;
+}
+
+int main(int argc, char **argv) {
     std::cout << "Single source shortest paths - Dijkstra algorithm" << std::endl;
+    if (argc > 1 && std::string(argv[1]) == "--bench") {
+        benchmark("grid 1000x1000, weights 1..100", Graph(gridGraph(1000, 100, 1.0, 1)));
+        benchmark("road-like 1000x1000, weights 1..10000", Graph(gridGraph(1000, 10000, 0.7, 2)));
+        benchmark("grid 300x300, weights 1..1000000", Graph(gridGraph(300, 1000000, 1.0, 4)));
+        benchmarkQueries("road-like 300x300, weights 1..10000", Graph(gridGraph(300, 10000, 0.7, 3)));
+        if (argc > 2) {
+            ThreadPool pool;
+            GraphLoader loader(pool);
+            std::string path = argv[2];
+            bool dimacs = path.size() > 3 && path.compare(path.size() - 3, 3, ".gr") == 0;
+            benchmark(path, Graph(dimacs ? loader.loadDimacs(path) : loader.loadEdgeList(path)));
+        }
+        return 0;
+    }
+    if (argc > 1)
+        return runFile(argv[1]);
 
     Graph graph(5);
     graph.addNode("s");
@@ -224,5 +1293,32 @@ int main() {
     DijkstraAlgorithm shortestPath(graph, "s");
     shortestPath();
     shortestPath.print();
+
+    ThreadPool pool;
+    DeltaStepping deltaStepping(graph, "s", pool, 3);
+    deltaStepping();
+    std::cout << "Delta-stepping:" << std::endl;
+    deltaStepping.print();
+
+    Graph far(2);
+    far.addNode("a");
+    far.addNode("b");
+    far.addEdge("a", "b", 400000000);
+    DeltaStepping smallDelta(far, "a", pool, 1);
+    smallDelta();
+    std::cout << "Delta-stepping with delta 1 over a 400000000 arc:" << std::endl;
+    smallDelta.print();
+
+    PointToPointQuery<LandmarkHeuristic> query(graph, LandmarkHeuristic(graph, 2));
+    query("s", "x");
+    query.print();
+    query("z", "t", PointToPointQuery<LandmarkHeuristic>::MODE::UNIDIRECTIONAL);
+    query.print();
+
+    ContractionHierarchy hierarchy(graph);
+    hierarchy("s", "x");
+    hierarchy.print();
+    hierarchy("x", "t");
+    hierarchy.print();
     return 0;
 }
\ No newline at end of file
@@ -3,6 +3,14 @@
 #include <vector>
 #include <stack>
 #include <unordered_map>
+#include <algorithm>
+#include <memory>
+#include <cstdint>
+#include <stdexcept>
+#include <chrono>
+#include <random>
+
+#include "CSRGraph.h"
 
 struct Node {
     int id = 0;
@@ -20,7 +28,19 @@ class Graph {
 public:
     Graph(int V): V(V) {
         nodes.resize(V, Node());
-        adjList.resize(V, Edges());
+    }
+
+    //Adopts a CSR, e.g. one made by GraphLoader, and names every vertex by
+    //its id. A CSR without in-arcs is rebuilt with them. The edge list is
+    //only rebuilt from the CSR if it is asked for or extended.
+    Graph(CSRGraph csr) : Graph(csr.getV()) {
+        for (int u = 0; u <= V-1; ++u) {
+            addNode(std::to_string(u));
+        }
+        if (!csr.hasReverse())
+            csr = CSRGraph(V, csr.edgeList<Edge>(), true);
+        csrGraph = std::make_unique<CSRGraph>(std::move(csr));
+        adopted = true;
     }
 
     void addNode(const std::string &name) {
@@ -36,20 +56,25 @@ public:
 
     void addEdge(int u, int v) {
         Edge edge{u ,v};
-        adjList[u].emplace_back(edge);
+        materialize();
         edgeVec.emplace_back(edge);
+        csrGraph.reset();
     }
 
-    Edges& edges() { return edgeVec; }
-    
-    Edges& edges(int u) {
-        return adjList[u];
+    Edges& edges() {
+        materialize();
+        return edgeVec;
     }
 
-    Edges edges (const std::string &u) {
-        return edges(nodeMap[u].id);
+    //Out- and in-adjacency in CSR form, built in bulk from the edge list on
+    //first use. The in-arcs are the transpose graph.
+    const CSRGraph& csr() {
+        if (!csrGraph) {
+            csrGraph = std::make_unique<CSRGraph>(V, edgeVec, true);
+        }
+        return *csrGraph;
     }
-    
+
     int getV () { return V; }
 
     Nodes& getNodes () {
@@ -60,18 +85,33 @@ public:
         return nodes[u];
     }
 
+    int nodeId(const std::string &name) const {
+        auto it = nodeMap.find(name);
+        if (it == nodeMap.end())
+            throw std::runtime_error("Unknown node " + name);
+        return it->second.id;
+    }
+
     void printEdges() {
-        for (auto &e: edgeVec) {
+        for (auto &e: edges()) {
             std::cout << nodes[e.u].name << "->" << nodes[e.v].name << std::endl;
         }
     }
 private:
+    void materialize() {
+        if (adopted) {
+            edgeVec = csrGraph->edgeList<Edge>();
+            adopted = false;
+        }
+    }
+
     int V = 0;
     int id = 0;
     Nodes nodes;
     std::unordered_map<std::string, Node> nodeMap;
     Edges edgeVec;
-    std::vector<Edges> adjList;
+    std::unique_ptr<CSRGraph> csrGraph;
+    bool adopted = false;
 };
 using Graphs = std::vector<Graph>;
 
@@ -107,8 +147,7 @@ public:
             if (color[u] == COLOR::WHITE) {
                 color[u] = COLOR::GRAY;
                 startTime[u] = ++time;
-                for (auto &edge : graph.edges(u)) {
-                    int v = edge.v;
+                for (int v : graph.csr().neighbors(u)) {
                     if (color[v] == COLOR::WHITE) {
                         tree[v] = u;
                         stack.push(v);
@@ -142,8 +181,7 @@ public:
         DFS dfs(graph);
         dfs();
 
-        Graph graphT = getGraphTranspose(graph);
-        Nodes nodes = graphT.getNodes();
+        Nodes nodes = graph.getNodes();
         std::vector<int> finishTime = dfs.finishTime;
 
         auto cmp = [&] (auto &n1, auto &n2) {
@@ -153,12 +191,12 @@ public:
         std::sort(std::begin(nodes), std::end(nodes), cmp);
 
         std::vector<std::vector<Node>> sccs;
-        std::vector<bool> visited(graphT.getV(), false);
+        std::vector<bool> visited(graph.getV(), false);
         for (auto &node : nodes) {
             int u = node.id;
             std::vector<Node> scc;
             if (!visited[u]) {
-                dfsLoop(u, graphT, visited, scc);
+                dfsLoop(u, visited, scc);
                 sccs.emplace_back(scc);
             };
 
@@ -167,43 +205,170 @@ public:
         return sccs;
     }
 
-    void dfsLoop(int u, Graph& graphT, std::vector<bool>& visited, std::vector<Node> &scc) {
+    //DFS over the transpose graph, i.e. along the in-arcs of the CSR.
+    void dfsLoop(int u, std::vector<bool>& visited, std::vector<Node> &scc) {
+        const CSRGraph &csr = graph.csr();
         std::stack<int> stack;
         stack.push(u);
         visited[u] = true;
-        scc.emplace_back(graphT.node(u));
+        scc.emplace_back(graph.node(u));
         while(!stack.empty()) {
             int u = stack.top();
             stack.pop();
-            for (auto &edge: graphT.edges(u)) {
-                int v = edge.v;
+            for (int v: csr.inNeighbors(u)) {
                 if (!visited[v]) {
                     visited[v]= true;
                     stack.push(v);
-                    scc.emplace_back(graphT.node(v));
+                    scc.emplace_back(graph.node(v));
                 }
             }
         }
     }
 
 private:
-    Graph getGraphTranspose(Graph &graph) {
-        Graph graphT(graph.getV());
-        for (auto &node: graph.getNodes()) {
-            graphT.addNode(node.name);
+    Graph &graph;
+};
+
+//Reflexive transitive closure as one bit per pair of strongly connected
+//components. Vertices of a component reach the same set, so the graph is
+//condensed first and only C x C bits are kept, C <= V.
+//
+//compute() returns the components in topological order of the condensed
+//DAG, so every arc between components points to a later one. Rows are built
+//from the last component back to the first: a row is its own bit OR-ed with
+//the rows of its successors, 64 components per word. Successors are taken in
+//topological order and one already reached through an earlier successor is
+//skipped, its row is contained in that one. A row only holds bits at or
+//after its own component, so the OR starts at that word.
+class TransitiveClosure {
+public:
+    TransitiveClosure(Graph &graph) : graph(graph) {}
+
+    void compute() {
+        StronglyConnectedComponents scc(graph);
+        std::vector<std::vector<Node>> sccs = scc.compute();
+        C = static_cast<int>(sccs.size());
+        words = (C + 63) / 64;
+        component.assign(graph.getV(), 0);
+        for (int c = 0; c <= C-1; ++c) {
+            for (auto &node: sccs[c]) {
+                component[node.id] = c;
+            }
+        }
+
+        std::vector<std::vector<int>> successors(C);
+        const CSRGraph &csr = graph.csr();
+        for (int u = 0; u <= graph.getV()-1; ++u) {
+            for (int v: csr.neighbors(u)) {
+                if (component[u] != component[v])
+                    successors[component[u]].emplace_back(component[v]);
+            }
         }
 
-        for (auto &edge : graph.edges()) {
-            graphT.addEdge(edge.v, edge.u);
+        rows.assign(static_cast<std::size_t>(C) * words, 0);
+        for (int c = C-1; c >= 0; --c) {
+            std::uint64_t *row = &rows[static_cast<std::size_t>(c) * words];
+            row[c / 64] |= bit(c);
+            std::sort(std::begin(successors[c]), std::end(successors[c]));
+            for (int d: successors[c]) {
+                if (row[d / 64] & bit(d))
+                    continue;
+
+                const std::uint64_t *other = &rows[static_cast<std::size_t>(d) * words];
+                for (int w = d / 64; w <= words-1; ++w) {
+                    row[w] |= other[w];
+                }
+            }
         }
+    }
+
+    bool reachable(int u, int v) const {
+        int d = component[v];
+        return rows[static_cast<std::size_t>(component[u]) * words + d / 64] & bit(d);
+    }
 
-        return graphT;
+    bool reachable(const std::string &u, const std::string &v) const {
+        return reachable(graph.nodeId(u), graph.nodeId(v));
+    }
+
+    int components() const {
+        return C;
+    }
+
+    std::size_t bytes() const {
+        return rows.size() * sizeof(std::uint64_t) + component.size() * sizeof(int);
+    }
+
+    void print() {
+        Nodes &nodes = graph.getNodes();
+        for (auto &u: nodes) {
+            std::cout << u.name << ":";
+            for (auto &v: nodes) {
+                if (reachable(u.id, v.id))
+                    std::cout << " " << v.name;
+            }
+            std::cout << std::endl;
+        }
+    }
+
+private:
+    static std::uint64_t bit(int c) {
+        return std::uint64_t(1) << (c % 64);
     }
 
     Graph &graph;
+    int C = 0;
+    int words = 0;
+    std::vector<int> component;
+    std::vector<std::uint64_t> rows;
 };
 
-int main() {
+//Random sparse digraph, answers checked against a BFS from every probed
+//source.
+void benchmark(int V, int degree) {
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> any(0, V-1);
+    Graph graph(V);
+    for (int i = 0; i <= V-1; ++i) {
+        graph.addNode(std::to_string(i));
+    }
+    for (int i = 0; i <= V * degree - 1; ++i) {
+        graph.addEdge(any(rng), any(rng));
+    }
+
+    TransitiveClosure closure(graph);
+    auto start = std::chrono::steady_clock::now();
+    closure.compute();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const CSRGraph &csr = graph.csr();
+    bool same = true;
+    std::vector<int> seen(V, -1);
+    for (int s = 0; s <= 99; ++s) {
+        int u = any(rng);
+        std::vector<int> queue {u};
+        seen[u] = s;
+        for (std::size_t head = 0; head < queue.size(); ++head) {
+            for (int v: csr.neighbors(queue[head])) {
+                if (seen[v] != s) {
+                    seen[v] = s;
+                    queue.emplace_back(v);
+                }
+            }
+        }
+        for (int v = 0; v <= V-1; ++v) {
+            same &= closure.reachable(u, v) == (seen[v] == s);
+        }
+    }
+
+    auto MB = [](double bytes) { return bytes / (1024.0 * 1024.0); };
+    std::cout << "Random digraph V=" << V << " with " << degree << " arcs per vertex: "
+              << closure.components() << " components, " << seconds * 1000 << " ms, "
+              << MB(closure.bytes()) << " MB (an int matrix takes " << MB(4.0 * V * V) << " MB)"
+              << (same ? "" : " (reachability differs from BFS!)") << std::endl;
+}
+
+int main(int argc, char **argv) {
     std::cout << "Strongly Connected Components" << std::endl;
     Graph graph(8);
     graph.addNode("a");
@@ -239,5 +404,18 @@ int main() {
         std::cout << std::endl;
     }
 
+    std::cout << "Transitive closure" << std::endl;
+    TransitiveClosure closure(graph);
+    closure.compute();
+    closure.print();
+    std::cout << std::boolalpha << "e reaches d: " << closure.reachable("e", "d")
+              << ", d reaches e: " << closure.reachable("d", "e") << std::endl;
+
+    if (argc > 1 && std::string(argv[1]) == "--bench") {
+        benchmark(20000, 1);
+        benchmark(20000, 2);
+        benchmark(50000, 3);
+    }
+
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <exception>
+#include <utility>
+
+//Fixed set of worker threads that run one job at a time. The calling thread
+//takes part as thread 0, so a pool of size 1 runs everything inline. Jobs
+//must not submit nested jobs to the same pool.
+class ThreadPool {
+public:
+    ThreadPool(int threads = std::thread::hardware_concurrency()) {
+        int T = std::max(1, threads);
+        for (int id = 1; id <= T-1; ++id) {
+            workers.emplace_back([this, id]() { workerLoop(id); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto &worker: workers) {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int size() const {
+        return static_cast<int>(workers.size()) + 1;
+    }
+
+    //Runs f(t) once on every thread t in [0, size()) and waits for all of
+    //them. If any f(t) throws, the first exception is rethrown once every
+    //thread is done.
+    void run(const std::function<void(int)> &f) {
+        if (workers.empty()) {
+            f(0);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = &f;
+            failure = nullptr;
+            pending = static_cast<int>(workers.size());
+            ++generation;
+        }
+        wake.notify_all();
+
+        runJob(f, 0);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this]() { return pending == 0; });
+        job = nullptr;
+        if (failure)
+            std::rethrow_exception(std::exchange(failure, nullptr));
+    }
+
+    //Runs f(i) for every i in [begin, end). Threads grab chunks of grain
+    //indices from a shared counter, so uneven work balances itself. f may
+    //also take the thread index as f(i, t) to address per-thread buffers.
+    template <typename F>
+    void parallelFor(std::size_t begin, std::size_t end, F f, std::size_t grain = 1024) {
+        if (begin >= end)
+            return;
+
+        std::atomic<std::size_t> next(begin);
+        grain = std::max<std::size_t>(1, grain);
+        run([&](int t) {
+            while (true) {
+                std::size_t from = next.fetch_add(grain);
+                if (from >= end)
+                    return;
+
+                std::size_t to = std::min(end, from + grain);
+                try {
+                    for (std::size_t i = from; i < to; ++i) {
+                        if constexpr (std::is_invocable_v<F&, std::size_t, int>)
+                            f(i, t);
+                        else
+                            f(i);
+                    }
+                } catch (...) {
+                    //No point in handing out the chunks that are left.
+                    next.store(end);
+                    throw;
+                }
+            }
+        });
+    }
+
+private:
+    //Runs f(t), keeping the first exception any thread throws for run().
+    void runJob(const std::function<void(int)> &f, int t) {
+        try {
+            f(t);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!failure)
+                failure = std::current_exception();
+        }
+    }
+
+    void workerLoop(int id) {
+        std::uint64_t seen = 0;
+        while (true) {
+            const std::function<void(int)> *f = nullptr;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&]() { return stopping || generation != seen; });
+                if (stopping)
+                    return;
+
+                seen = generation;
+                f = job;
+            }
+
+            runJob(*f, id);
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--pending == 0)
+                    done.notify_one();
+            }
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void(int)> *job = nullptr;
+    std::exception_ptr failure;
+    std::uint64_t generation = 0;
+    int pending = 0;
+    bool stopping = false;
+};
@@ -2,6 +2,11 @@
 #include <vector>
 #include <stack>
 #include <unordered_map>
+#include <algorithm>
+#include <memory>
+#include <string>
+
+#include "CSRGraph.h"
 
 struct Node {
     int id;
@@ -9,6 +14,12 @@ struct Node {
 };
 using Nodes = std::vector<Node>;
 
+struct Edge {
+    int u = 0;
+    int v = 0;
+};
+using Edges = std::vector<Edge>;
+
 
 template <typename Graph>
 struct DFS {
@@ -73,15 +84,31 @@ struct DFS {
 class Graph {
 public:
     Graph(int V): V(V) {
-        adjList.resize(V, std::vector<int>());
     }
-    
+
+    //Adopts a CSR, e.g. one made by GraphLoader, and names every vertex by
+    //its id. The edge list is only rebuilt from the CSR if it is extended.
+    Graph(CSRGraph csr) : V(csr.getV()), adopted(true) {
+        for (int u = 0; u <= V-1; ++u) {
+            addNode(std::to_string(u));
+        }
+        csrGraph = std::make_unique<CSRGraph>(std::move(csr));
+    }
+
     int getV() {
         return V;
     }
 
-    std::vector<int>& edges(int u) {
-        return adjList[u];
+    std::span<const int> edges(int u) {
+        return csr().neighbors(u);
+    }
+
+    //Adjacency in CSR form, built in bulk from the edge list on first use.
+    const CSRGraph& csr() {
+        if (!csrGraph) {
+            csrGraph = std::make_unique<CSRGraph>(V, edgeList);
+        }
+        return *csrGraph;
     }
 
     void addNode(const std::string &name) {
@@ -92,7 +119,12 @@ public:
     }
 
     void addEdge(const std::string &u, const std::string &v) {
-        adjList[nameIDMap[u]].emplace_back(nameIDMap[v]);
+        if (adopted) {
+            edgeList = csrGraph->edgeList<Edge>();
+            adopted = false;
+        }
+        edgeList.emplace_back(Edge{nameIDMap[u], nameIDMap[v]});
+        csrGraph.reset();
     }
 
     Nodes topologicalOrder() {
@@ -121,7 +153,9 @@ private:
     Nodes nodes;
 
     std::unordered_map<std::string, int> nameIDMap;
-    std::vector<std::vector<int>> adjList;
+    Edges edgeList;
+    std::unique_ptr<CSRGraph> csrGraph;
+    bool adopted = false;
 
 };
 